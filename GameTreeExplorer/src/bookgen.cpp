@@ -0,0 +1,99 @@
+#include "objects/Algo.h"
+#include "objects/OpeningBook.h"
+#include "objects/ProofSearch.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+// Collects every position reachable within the given plies, one per twin pair
+// seen keeps the most plies left a position was reached with; a position reached again
+// with more plies left is expanded again, since the first visit may have stopped short
+void collectPositions(Position &position, int plies, std::unordered_map<std::uint64_t, int> &seen, std::vector<Position> &out)
+{
+    if (position.isGameOver())
+        return;
+    const auto [entry, added] = seen.emplace(position.getCanonicalHash(), plies);
+    if (added)
+        out.push_back(position);
+    else if (entry->second >= plies)
+        return;
+    entry->second = plies;
+    if (plies == 0)
+        return;
+
+    Move moves[Position::MaxMoves];
+    const int count = position.generateMoves(moves);
+    for (int i = 0; i < count; ++i)
+    {
+        position.makeMove(moves[i]);
+        collectPositions(position, plies - 1, seen, out);
+        position.unmakeMove(moves[i]);
+    }
+}
+} // namespace
+
+// Offline tool searching every position of the first plies of a board size and writing its opening book
+// Usage: bookgen <board size including edges> [plies] [ms per position] [output file]
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: bookgen <board size including edges> [plies] [ms per position] [output file]\n";
+        return 1;
+    }
+
+    try
+    {
+        const int size = std::stoi(argv[1]);
+        const int plies = argc > 2 ? std::stoi(argv[2]) : 6;
+        Algorithm::SearchConfig config;
+        config.timeLimitMs = argc > 3 ? std::stoi(argv[3]) : 1000;
+        const std::string path = argc > 4 ? argv[4] : OpeningBook::fileName(size);
+        if (size < 3 || size > Position::MaxSize)
+            throw std::out_of_range("Board size not supported");
+
+        std::unordered_map<std::uint64_t, int> seen;
+        std::vector<Position> positions;
+        Position start(size);
+        collectPositions(start, plies, seen, positions);
+        std::cout << "Searching " << positions.size() << " positions of the first " << plies
+                  << " plies on a " << size << "x" << size << " board..." << std::endl;
+
+        std::vector<OpeningBook::Entry> entries;
+        for (std::size_t i = 0; i < positions.size(); ++i)
+        {
+            // Try to prove the result first, fall back to the heuristic search
+            Algorithm::SearchConfig proofConfig = config;
+            proofConfig.timeLimitMs = config.timeLimitMs / 2;
+            Algorithm::SearchResult result = Algorithm::depthFirstProofNumberSearch(positions[i], proofConfig);
+            if (!result.proven)
+                result = Algorithm::iterativeDeepening(positions[i], config);
+            if (result.hasMove)
+            {
+                entries.push_back(OpeningBook::Entry{positions[i].getCanonicalHash(), result.score,
+                                                     result.bestMove.token,
+                                                     static_cast<std::uint8_t>(std::min(result.stats.depth, 255)), 0});
+            }
+            if ((i + 1) % 100 == 0)
+                std::cout << "  " << i + 1 << " / " << positions.size() << std::endl;
+        }
+
+        if (!OpeningBook::save(path, size, entries) || !OpeningBook::open(path))
+        {
+            std::cerr << "Failed to write " << path << "\n";
+            return 1;
+        }
+        std::cout << "Wrote " << entries.size() << " positions to " << path << std::endl;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
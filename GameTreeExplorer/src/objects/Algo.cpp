@@ -1,13 +1,21 @@
 #include "Algo.h"
 #include "GameSate.h"
+#include "GameTable.h"
+#include "MonteCarlo.h"
+#include "OpeningBook.h"
 #include "Player.h"
+#include "ProofSearch.h"
 #include <SFML/System/Sleep.hpp>
 #include <SFML/System/Time.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <queue>
 #include <stack>
 #include <utility>
+#include <vector>
 // Enum representing possible outcomes of a game state evaluation
 enum Outcome {
 	WON,
@@ -58,85 +66,734 @@ std::pair<int, int> Algorithm::calculatePossibleMove(int x, int y, Player &playe
 			y + direction.y);
 	return pairMove;
 }
-// Recursive function to evaluate moves and outcomes for the player
-Outcome recusionMove(GameState &state, Player &player, std::stack<Algorithm::MoveStep> &history, std::queue<Algorithm::MoveStep> &visual, int depth, int moveNum, bool &hasWon) {
-	// If a winning path has already been found, return outcome accordingly
-	if (hasWon)
-		return player.getPlayerNumber() == 1 ? WON : LOSS;
+// Builds the compact position of the game with the given player to move
+Position Algorithm::toPosition(GameState &state, Player &player) {
+	const int size = static_cast<int>(state.getCurrentPlayer().getTokenCount()) + 2;
+	if (size > Position::MaxSize)
+		throw std::out_of_range("Board too large for the search engine");
 
-// Check if current player is in winning state
-if (Algorithm::isWinningState(player)) {
-	if (player.getPlayerNumber() == 1)
-		hasWon = true;
-	return WON;
+	Position position(size);
+	// Player 0 tokens keep their row and player 1 tokens keep their column
+	auto placeTokens = [&position](Player &owner) {
+		for (auto token : owner.getTokens()) {
+			auto [x, y] = token->getPosition();
+			if (token->getPlayer() == 0)
+				position.setCoord(0, y - 1, x);
+			else
+				position.setCoord(1, x - 1, y);
+		}
+	};
+	placeTokens(state.getCurrentPlayer());
+	placeTokens(state.getOtherPlayer());
+	position.setSideToMove(player.getPlayerNumber());
+	return position;
 }
-// Check if opponent is in winning state, meaning current player lost
-if (Algorithm::isWinningState(Algorithm::getOpponent(state, player))) {
-	return LOSS;
+
+// Converts a compact move to board coordinates
+Algorithm::MoveStep Algorithm::toMoveStep(const Move &move) {
+	auto from = Position::toCell(move.player, move.token, move.from);
+	auto to = Position::toCell(move.player, move.token, move.to);
+	return MoveStep {{from[0], from[1]}, {to[0], to[1]}, move.player};
+}
+
+// Converts a move between board coordinates to a compact move
+Move Algorithm::toMove(const MoveStep &step) {
+	// Player 0 moves along its row and player 1 along its column
+	if (step.playerNumber == 0)
+		return Move {0, static_cast<std::uint8_t>(step.from.second - 1),
+				static_cast<std::uint8_t>(step.from.first), static_cast<std::uint8_t>(step.to.first)};
+	return Move {1, static_cast<std::uint8_t>(step.from.first - 1),
+			static_cast<std::uint8_t>(step.from.second), static_cast<std::uint8_t>(step.to.second)};
+}
+
+namespace {
+using Algorithm::WinScore;
+constexpr int Infinity = WinScore + 1;                          // Bound larger than any score
+constexpr int MinWinScore = WinScore - Position::MaxGameLength; // Smallest score that still means a forced win
+
+// Checks if a score is a proven win or loss rather than a heuristic guess
+bool isDecisive(int score) {
+	return score >= MinWinScore || score <= -MinWinScore;
+}
+
+// Checks if an iteration of the given depth settles a decisive score for good
+// Race scores reach past the depth, so a quicker win only a deeper iteration sees may
+// still exist until the distance fits inside the depth
+bool isSettled(int score, int depth) {
+	return isDecisive(score) && WinScore - std::abs(score) <= depth;
 }
 
-int childMoveNum = 0;
-// Iterate over all tokens of the player
-for (auto token : player.getTokens()) {
-	// Skip tokens that cannot move
-	if (!token->isMovable())
-		continue;
+// Win and loss scores count plies from the root, the search table counts them from the
+// stored position so an entry stays right wherever the position comes up again
+int toTableScore(int score, int ply) {
+	if (score >= MinWinScore)
+		return score + ply;
+	if (score <= -MinWinScore)
+		return score - ply;
+	return score;
+}
 
-	// Calculate possible move for the token
-	std::pair<int, int> newMove =
-		Algorithm::calculatePossibleMove(token->getPosition().first,
-				token->getPosition().second, player, state);
+int fromTableScore(int score, int ply) {
+	if (score >= MinWinScore)
+		return score - ply;
+	if (score <= -MinWinScore)
+		return score + ply;
+	return score;
+}
 
-	// If no valid move, continue to next token
-	if (newMove.first == -1) {
-		continue;
+// Triangular table of principal variations: row ply holds the best line found from that ply
+struct PvTable {
+	static constexpr int MaxLength = Algorithm::PrincipalVariation::MaxLength;
+	Move moves[MaxLength][MaxLength];
+	int length[MaxLength + 1] = {};
+
+	// Empties the line of a node as it is entered
+	void clear(int ply) {
+		if (ply <= MaxLength)
+			length[ply] = 0;
 	}
 
-	// Store old position of the token
-	std::pair<int, int> oldMove =
-		make_pair(token->getPosition().first, token->getPosition().second);
+	// Makes the move followed by the child's line the line of the node at ply
+	void update(int ply, const Move &move) {
+		if (ply >= MaxLength)
+			return;
+		const int childLength = std::min(length[ply + 1], MaxLength - 1);
+		moves[ply][0] = move;
+		for (int i = 0; i < childLength; ++i)
+			moves[ply][i + 1] = moves[ply + 1][i];
+		length[ply] = childLength + 1;
+	}
 
-	// Add move to visual queue for visualization
-	visual.push(Algorithm::MoveStep {oldMove , newMove, player.getPlayerNumber()});
+	// Copies the line found from the root
+	void extract(Algorithm::PrincipalVariation &line) const {
+		line.length = length[0];
+		std::copy(moves[0], moves[0] + length[0], line.moves);
+	}
+};
 
-	// Apply the move on the board
-	state.getBoard().moveTokenRaw(oldMove.first, oldMove.second, newMove.first, newMove.second);
+// State shared by all nodes of one search
+struct SearchContext {
+	const Algorithm::SearchConfig &config;
+	Algorithm::SearchStats &stats;
+	std::chrono::steady_clock::time_point start;
+	bool stopped = false;      // Set once the time budget runs out
+	bool hitHorizon = false;   // Set if the iteration cut off any line with the evaluation
+	PvTable pv {};             // Best lines of the nodes on the current path
+};
 
-	// Add move to history stack for backtracking
-	history.push(Algorithm::MoveStep {oldMove, newMove, player.getPlayerNumber()});
+// Milliseconds elapsed since the search started
+int elapsedMs(const SearchContext &ctx) {
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - ctx.start).count());
+}
 
-	// Recursively evaluate opponent's moves after this move
-	Outcome result = recusionMove(state, Algorithm::getOpponent(state, player), history, visual, depth + 1, childMoveNum++, hasWon);
+// Checks the clock and the stop request every few thousand nodes and flags the search as stopped
+bool outOfTime(SearchContext &ctx) {
+	if (ctx.stopped)
+		return true;
+	if ((ctx.stats.nodes & 2047) != 0)
+		return false;
+	ctx.stopped = ctx.config.stop.stop_requested()
+			|| (ctx.config.timeLimitMs > 0 && elapsedMs(ctx) >= ctx.config.timeLimitMs);
+	return ctx.stopped;
+}
 
-	// Undo the move to restore state
-	state.getBoard().moveTokenRaw(newMove.first, newMove.second, oldMove.first, oldMove.second);
+// Static evaluation from the side to move's point of view
+// A player closer to getting all tokens home is better off, moving next is worth a little
+int evaluate(const Position &position) {
+	const int side = position.getSideToMove();
+	return (position.getRemainingDistance(1 - side) - position.getRemainingDistance(side)) * 10 + 5;
+}
 
-	// Add revert move to visual queue for visualization
-	visual.push(Algorithm::MoveStep {newMove , oldMove, player.getPlayerNumber()});
+// Cheap ordering key: jumps first, then moves that block an opponent token,
+// then moves that bring a token home
+int moveOrderScore(const Position &position, const Move &move) {
+	int score = (move.to - move.from) * 4;
+	const auto cell = position.toCell(move.player, move.token, move.to);
+	// The opponent token that would step onto this cell next
+	const int blockedX = move.player == 0 ? cell[0] : cell[0] - 1;
+	const int blockedY = move.player == 0 ? cell[1] - 1 : cell[1];
+	if (position.ownerAt(blockedX, blockedY) == 1 - move.player)
+		score += 2;
+	if (move.to == position.getSize() - 1)
+		score += 1;
+	return score;
+}
 
-	// If opponent lost or winning path found, return WON for current player
-	if (result == LOSS || hasWon) {
-		if (player.getPlayerNumber() == 1)
-			hasWon = true;
-		return WON;
+// Sorts moves so the most promising ones are searched first
+void orderMoves(const Position &position, Move *moves, int count) {
+	int keys[Position::MaxMoves];
+	for (int i = 0; i < count; ++i)
+		keys[i] = moveOrderScore(position, moves[i]);
+	// Insertion sort, move lists are short
+	for (int i = 1; i < count; ++i) {
+		Move move = moves[i];
+		int key = keys[i];
+		int j = i - 1;
+		for (; j >= 0 && keys[j] < key; --j) {
+			moves[j + 1] = moves[j];
+			keys[j + 1] = keys[j];
+		}
+		moves[j + 1] = move;
+		keys[j + 1] = key;
 	}
+}
 
-	// Remove move from history as it did not lead to a win
-	history.pop();
+// Depth reduction for a late-ordered move, 0 if it must be searched fully
+// Jumps are never reduced since they are the tactical moves of this game
+int lateMoveReduction(const Algorithm::SearchConfig &config, int depth, int moveIndex, const Move &move) {
+	if (!config.lateMoveReductions || depth < config.lmrMinDepth || moveIndex < config.lmrFullMoves)
+		return 0;
+	if (move.to - move.from > 1)
+		return 0;
+	int reduction = 1;
+	if (depth >= 6 && moveIndex >= 2 * config.lmrFullMoves)
+		reduction = 2;
+	return std::min(reduction, depth - 2);
 }
 
-// No winning path found, return LOSS
-return LOSS;
+int alphaBeta(Position &position, int depth, int alpha, int beta, int ply, SearchContext &ctx);
 
+// Searches a child position, negating the window only if the turn actually passed
+int searchChild(Position &position, int parentSide, int depth, int alpha, int beta, int ply, SearchContext &ctx) {
+	if (position.getSideToMove() == parentSide)
+		return alphaBeta(position, depth, alpha, beta, ply, ctx);
+	return -alphaBeta(position, depth, -beta, -alpha, ply, ctx);
 }
-// Attempts to play the next move for the player in the game state
-bool Algorithm::playNextMove(GameState &state, Player &player, std::stack<MoveStep> &history, std::queue<MoveStep> &visual, int maxDepth = 0, int moveNum) {
-	// Create a copy of the game state to explore moves
-	GameState newState = state;
-	bool hasFoundWin = false;
-	// Start recursive move evaluation
-	recusionMove(newState, player, history, visual, 0, 1, hasFoundWin);
-	// Currently always returns false (not implemented fully)
-	return false;
+
+// Depth-limited fail-soft negamax alpha-beta over the compact position
+int alphaBeta(Position &position, int depth, int alpha, int beta, int ply, SearchContext &ctx) {
+	ctx.stats.nodes++;
+	ctx.pv.clear(ply);
+
+	const int side = position.getSideToMove();
+	if (position.hasWon(side))
+		return WinScore - ply;
+	if (position.hasWon(1 - side))
+		return -(WinScore - ply);
+	// Once the armies are apart the result follows from the step counts
+	if (position.isRace()) {
+		const int mateScore = WinScore - ply - position.racePlies();
+		return position.winsRace() ? mateScore : -mateScore;
+	}
+	if (depth <= 0) {
+		ctx.hitHorizon = true;
+		return evaluate(position);
+	}
+	if (outOfTime(ctx))
+		return 0;
+
+	// An earlier search of this position, from this turn, an earlier one or pondering,
+	// may settle it at once and otherwise knows which move to try first
+	TranspositionTable &table = Algorithm::searchTable();
+	const std::uint64_t key = position.getCanonicalHash();
+	int tableMove = 0xFF;
+	if (const TranspositionTable::Entry *entry = table.probe(key)) {
+		tableMove = entry->move;
+		const int score = fromTableScore(entry->score, ply);
+		if (entry->depth >= depth && (entry->bound == TranspositionTable::Exact
+				|| (entry->bound == TranspositionTable::Lower && score >= beta)
+				|| (entry->bound == TranspositionTable::Upper && score <= alpha))) {
+			// Unless the entry settles the position within the depth left, it may rest on
+			// evaluations or a long race, so the iteration can't claim to have seen it all
+			if (!isSettled(entry->score, depth))
+				ctx.hitHorizon = true;
+			return score;
+		}
+	}
+
+	Move moves[Position::MaxMoves];
+	const int count = position.generateMoves(moves);
+	if (count == 0)
+		return evaluate(position);
+	orderMoves(position, moves, count);
+	for (int i = 1; i < count; ++i) {
+		if (moves[i].token == tableMove) {
+			std::rotate(moves, moves + i, moves + i + 1);
+			break;
+		}
+	}
+
+	const int alphaStart = alpha;
+	int best = -Infinity;
+	int bestToken = moves[0].token;
+	for (int i = 0; i < count; ++i) {
+		position.makeMove(moves[i]);
+		int score;
+		const int reduction = isDecisive(alpha) ? 0 : lateMoveReduction(ctx.config, depth, i, moves[i]);
+		if (reduction > 0) {
+			// Prove the late move is no better than alpha with a shallow null-window search,
+			// and only search it fully if that fails high
+			ctx.stats.reductions++;
+			score = searchChild(position, side, depth - 1 - reduction, alpha, alpha + 1, ply + 1, ctx);
+			if (score > alpha && !ctx.stopped) {
+				ctx.stats.lmrResearches++;
+				score = searchChild(position, side, depth - 1, alpha, beta, ply + 1, ctx);
+			}
+		} else {
+			score = searchChild(position, side, depth - 1, alpha, beta, ply + 1, ctx);
+		}
+		position.unmakeMove(moves[i]);
+
+		if (ctx.stopped)
+			return 0;
+		if (score > best) {
+			best = score;
+			bestToken = moves[i].token;
+			if (score > alpha) {
+				alpha = score;
+				ctx.pv.update(ply, moves[i]);
+			}
+			if (alpha >= beta)
+				break;
+		}
+	}
+
+	const auto bound = best <= alphaStart ? TranspositionTable::Upper
+			: best >= beta ? TranspositionTable::Lower : TranspositionTable::Exact;
+	table.store(key, toTableScore(best, ply), depth, bound, bestToken);
+	return best;
+}
+
+// Searches every root move with the given window and reports the best one
+int searchRoot(Position &position, Move *moves, int count, int depth, int alpha, int beta, SearchContext &ctx, int &bestIndex) {
+	const int side = position.getSideToMove();
+	int best = -Infinity;
+	bestIndex = 0;
+	ctx.pv.clear(0);
+	for (int i = 0; i < count; ++i) {
+		position.makeMove(moves[i]);
+		int score = searchChild(position, side, depth - 1, alpha, beta, 1, ctx);
+		position.unmakeMove(moves[i]);
+
+		if (ctx.stopped)
+			return best;
+		if (score > best) {
+			best = score;
+			bestIndex = i;
+			ctx.pv.update(0, moves[i]);
+			if (score > alpha)
+				alpha = score;
+			if (alpha >= beta)
+				break;
+		}
+	}
+	return best;
+}
+
+// Searches the root moves with an aspiration window around the previous score, widening
+// only the side that failed until the score falls inside
+int searchAspiration(Position &position, Move *moves, int count, int depth, int previous, SearchContext &ctx, int &bestIndex) {
+	const Algorithm::SearchConfig &config = ctx.config;
+	int delta = config.aspirationWindow;
+	int alpha = -Infinity;
+	int beta = Infinity;
+	if (config.aspiration && depth > 1 && !isDecisive(previous)) {
+		alpha = std::max(previous - delta, -Infinity);
+		beta = std::min(previous + delta, Infinity);
+	}
+
+	while (true) {
+		const int score = searchRoot(position, moves, count, depth, alpha, beta, ctx, bestIndex);
+		if (ctx.stopped)
+			return score;
+
+		if (score <= alpha && alpha > -Infinity) {
+			ctx.stats.failLows++;
+			delta *= config.aspirationGrowth;
+			alpha = std::max(score - delta, -Infinity);
+		} else if (score >= beta && beta < Infinity) {
+			ctx.stats.failHighs++;
+			delta *= config.aspirationGrowth;
+			beta = std::min(score + delta, Infinity);
+		} else {
+			return score;
+		}
+		ctx.stats.researches++;
+	}
+}
+
+// Reads a proven outcome for the side to move from the solver table
+bool probeOutcome(const Position &position, Outcome &outcome) {
+	const TranspositionTable::Entry *entry = Algorithm::solverTable().probe(position.getCanonicalHash());
+	if (!entry || entry->depth != TranspositionTable::SolvedDepth)
+		return false;
+	outcome = entry->score > 0 ? WON : LOSS;
+	return true;
+}
+
+// Records a proven outcome for the side to move in the solver table
+void storeOutcome(const Position &position, Outcome outcome) {
+	Algorithm::solverTable().store(position.getCanonicalHash(), outcome == WON ? WinScore : -WinScore,
+			TranspositionTable::SolvedDepth, TranspositionTable::Exact);
+}
+
+// Answers from a solved game table when one is available for this board size
+// The line takes the fastest win for whoever is winning and the slowest loss for
+// whoever is losing; tables without distances fall back to the first winning move
+bool probeGameTable(const Position &root, Algorithm::SearchResult &result) {
+	const GameTable *table = GameTable::forSize(root.getSize());
+	if (!table || root.isGameOver())
+		return false;
+	const GameTable::Value value = table->probe(root);
+	if (value == GameTable::Unknown)
+		return false;
+
+	Position position = root;
+	result.line.length = 0;
+	while (!position.isGameOver() && result.line.length < Algorithm::PrincipalVariation::MaxLength) {
+		Move moves[Position::MaxMoves];
+		const int count = position.generateMoves(moves);
+		if (count == 0)
+			break;
+
+		const int side = position.getSideToMove();
+		int best = -1;
+		bool bestWins = false;
+		int bestPlies = 0;
+		for (int i = 0; i < count; ++i) {
+			position.makeMove(moves[i]);
+			const GameTable::Value child = table->probe(position);
+			const int plies = table->pliesToEnd(position);
+			const bool sameSide = position.getSideToMove() == side;
+			position.unmakeMove(moves[i]);
+
+			const bool wins = child == (sameSide ? GameTable::Win : GameTable::Loss);
+			if (best == -1 || (wins && !bestWins) ||
+				(wins == bestWins && (wins ? plies < bestPlies : plies > bestPlies))) {
+				best = i;
+				bestWins = wins;
+				bestPlies = plies;
+			}
+		}
+		result.line.moves[result.line.length++] = moves[best];
+		position.makeMove(moves[best]);
+	}
+
+	// Distances give scores like the search's: quicker wins score higher
+	const int plies = std::max(0, table->pliesToEnd(root));
+	result.hasMove = result.line.length > 0;
+	result.bestMove = result.line.moves[0];
+	result.score = value == GameTable::Win ? WinScore - plies : -(WinScore - plies);
+	result.proven = true;
+	return result.hasMove;
+}
+
+// Answers from the opening book when it has the position
+// The line follows the book for as long as it knows the positions
+bool probeOpeningBook(const Position &root, Algorithm::SearchResult &result) {
+	const OpeningBook *book = OpeningBook::forSize(root.getSize());
+	if (!book || root.isGameOver())
+		return false;
+	const OpeningBook::Entry *entry = book->probe(root);
+	if (!entry)
+		return false;
+	result.score = entry->score;
+	result.proven = isDecisive(entry->score);
+	result.stats.depth = entry->depth;
+
+	Position position = root;
+	result.line.length = 0;
+	for (; entry && result.line.length < Algorithm::PrincipalVariation::MaxLength; entry = book->probe(position)) {
+		Move moves[Position::MaxMoves];
+		const int count = position.generateMoves(moves);
+		const Move *move = std::find_if(moves, moves + count,
+				[entry](const Move &candidate) { return candidate.token == entry->token; });
+		if (move == moves + count)
+			break;
+		result.line.moves[result.line.length++] = *move;
+		position.makeMove(*move);
+		if (position.isGameOver())
+			break;
+	}
+
+	result.hasMove = result.line.length > 0;
+	if (result.hasMove)
+		result.bestMove = result.line.moves[0];
+	return result.hasMove;
+}
+
+// Outcome for the parent's side given the outcome for the side to move in the child
+Outcome parentOutcome(const Position &child, int parentSide, Outcome childOutcome) {
+	if (child.getSideToMove() == parentSide)
+		return childOutcome;
+	return childOutcome == WON ? LOSS : WON;
+}
+} // namespace
+
+// Table of positions proven won or lost by the solvers, kept across bot turns
+TranspositionTable &Algorithm::solverTable() {
+	static TranspositionTable table(64);
+	return table;
+}
+
+// Table of alpha-beta results, kept across bot turns and filled further by pondering
+TranspositionTable &Algorithm::searchTable() {
+	static TranspositionTable table(32);
+	return table;
+}
+
+// Iterative-deepening alpha-beta search with aspiration windows at the root
+// Each iteration starts with a narrow window around the previous score and
+// widens it on the side that failed until the score falls inside
+// Every line up to the depth is searched in full, so a win or loss whose distance fits
+// inside the depth is the quickest one; only then does a decisive score end the search.
+// Late move reductions search some lines shallower and may still hide a quicker win
+Algorithm::SearchResult Algorithm::iterativeDeepening(const Position &root, const SearchConfig &config) {
+	SearchResult result;
+	SearchContext ctx {config, result.stats, std::chrono::steady_clock::now()};
+
+	Position position = root;
+	Move moves[Position::MaxMoves];
+	const int count = position.generateMoves(moves);
+	if (count == 0 || position.isGameOver())
+		return result;
+
+	orderMoves(position, moves, count);
+	result.hasMove = true;
+	result.bestMove = moves[0];
+	result.line.length = 1;
+	result.line.moves[0] = moves[0];
+
+	for (int depth = 1; depth <= config.maxDepth; ++depth) {
+		ctx.hitHorizon = false;
+		int bestIndex = 0;
+		const int score = searchAspiration(position, moves, count, depth, result.score, ctx, bestIndex);
+
+		// A partial iteration is discarded in favour of the last complete one
+		if (ctx.stopped)
+			break;
+
+		// Search the best move first in the next iteration
+		std::rotate(moves, moves + bestIndex, moves + bestIndex + 1);
+		result.bestMove = moves[0];
+		ctx.pv.extract(result.line);
+		result.score = score;
+		result.proven = isDecisive(score);
+		result.stats.depth = depth;
+		if (config.onProgress) {
+			result.stats.timeMs = elapsedMs(ctx);
+			config.onProgress(result);
+		}
+
+		// Stop once the result is proven at its shortest or the whole tree fit inside the depth
+		if (isSettled(score, depth) || !ctx.hitHorizon)
+			break;
+	}
+
+	result.stats.timeMs = elapsedMs(ctx);
+	return result;
+}
+
+// Iterative deepening of the config.multiPv best root moves
+// Every iteration finds the best move, then the best of the others, and so on, each
+// with an aspiration window around that rank's previous score. The later ranks mostly
+// walk subtrees the search table already holds, so K lines cost far less than K searches
+std::vector<Algorithm::SearchResult> Algorithm::multiPvSearch(const Position &root, const SearchConfig &config) {
+	SearchStats stats;
+	SearchContext ctx {config, stats, std::chrono::steady_clock::now()};
+
+	Position position = root;
+	Move moves[Position::MaxMoves];
+	const int count = position.generateMoves(moves);
+	if (count == 0 || position.isGameOver())
+		return {};
+
+	orderMoves(position, moves, count);
+	std::vector<SearchResult> lines(std::clamp(config.multiPv, 1, count));
+	for (std::size_t i = 0; i < lines.size(); ++i) {
+		lines[i].hasMove = true;
+		lines[i].bestMove = moves[i];
+		lines[i].line.length = 1;
+		lines[i].line.moves[0] = moves[i];
+	}
+
+	std::vector<SearchResult> current = lines;
+	for (int depth = 1; depth <= config.maxDepth; ++depth) {
+		ctx.hitHorizon = false;
+		bool allSettled = true;
+		// Ranks already filled this iteration sit at the front of moves and are left out
+		for (int rank = 0; rank < static_cast<int>(lines.size()); ++rank) {
+			int bestIndex = 0;
+			const int score = searchAspiration(position, moves + rank, count - rank, depth, lines[rank].score, ctx, bestIndex);
+			if (ctx.stopped)
+				break;
+			std::rotate(moves + rank, moves + rank + bestIndex, moves + rank + bestIndex + 1);
+			current[rank].bestMove = moves[rank];
+			ctx.pv.extract(current[rank].line);
+			current[rank].score = score;
+			current[rank].proven = isDecisive(score);
+			allSettled = allSettled && isSettled(score, depth);
+		}
+
+		// A partial iteration is discarded in favour of the last complete one
+		if (ctx.stopped)
+			break;
+
+		lines = current;
+		stats.depth = depth;
+		if (config.onProgress) {
+			lines[0].stats = stats;
+			lines[0].stats.timeMs = elapsedMs(ctx);
+			config.onProgress(lines[0]);
+		}
+
+		// Stop once every line is proven at its shortest or the whole tree fit inside the depth
+		if (allSettled || !ctx.hitHorizon)
+			break;
+	}
+
+	stats.timeMs = elapsedMs(ctx);
+	for (SearchResult &line : lines)
+		line.stats = stats;
+	return lines;
 }
 
+// Ranks root moves with config.engine: the Monte Carlo graph ranks its own root moves,
+// the other engines use the multi-PV alpha-beta search
+std::vector<Algorithm::SearchResult> Algorithm::analyzePosition(const Position &position, const SearchConfig &config) {
+	if (config.engine == Engine::MonteCarlo) {
+		MonteCarloTree &tree = monteCarloTree();
+		const SearchResult best = tree.search(position, config);
+		std::vector<SearchResult> lines = tree.rankRootMoves(config.multiPv);
+		for (SearchResult &line : lines)
+			line.stats = best.stats;
+		return lines;
+	}
+	return multiPvSearch(position, config);
+}
+
+// Answers from a solved game table or the opening book, otherwise searches with config.engine
+Algorithm::SearchResult Algorithm::searchPosition(const Position &position, const SearchConfig &config) {
+	SearchResult result;
+	// A solved table or the opening book answer at once, no search needed
+	if ((config.useGameTables && probeGameTable(position, result)) ||
+			(config.useOpeningBook && probeOpeningBook(position, result)))
+		return result;
+
+	switch (config.engine) {
+	case Engine::ProofNumber:
+		return proofNumberSearch(position, config);
+	case Engine::DepthFirstProofNumber:
+		return depthFirstProofNumberSearch(position, config);
+	case Engine::MonteCarlo:
+		// The tree of the last turn is kept, GameManager moves its root along the moves played
+		return monteCarloTree().search(position, config);
+	case Engine::AlphaBeta:
+	default:
+		return iterativeDeepening(position, config);
+	}
+}
+
+// Shows the expected line and takes it back so the preview ends on the real board
+void Algorithm::previewLine(const PrincipalVariation &line, std::queue<MoveStep> &visual) {
+	for (int i = 0; i < line.length; ++i)
+		visual.push(toMoveStep(line.moves[i]));
+	for (int i = line.length - 1; i >= 0; --i) {
+		MoveStep step = toMoveStep(line.moves[i]);
+		visual.push(MoveStep {step.to, step.from, step.playerNumber});
+	}
+}
+
+// Plays the next move using the engine selected in config
+bool Algorithm::playNextMove(GameState &state, Player &player, PrincipalVariation &line, std::queue<MoveStep> &visual, const SearchConfig &config, SearchStats &stats) {
+	const SearchResult result = searchPosition(toPosition(state, player), config);
+	stats = result.stats;
+	line = result.line;
+	if (!result.hasMove)
+		return false;
+	previewLine(line, visual);
+	return true;
+}
+
+// Recursive function proving whether the side to move can force a win
+// The winning line, or the first move's line when there is none, is left in the PV table
+// and every explored move is added to the visual queue
+Outcome recusionMove(Position &position, PvTable &pv, std::queue<Algorithm::MoveStep> &visual, int ply) {
+	const int side = position.getSideToMove();
+	pv.clear(ply);
+
+	// Check if current player is in winning state
+	if (position.hasWon(side))
+		return WON;
+	// Check if opponent is in winning state, meaning current player lost
+	if (position.hasWon(1 - side))
+		return LOSS;
+
+	// The root always searches its moves so it ends up with a move to play
+	Outcome known;
+	if (ply > 0 && probeOutcome(position, known))
+		return known;
+	// Once the armies are apart the one needing fewer steps wins
+	if (ply > 0 && position.isRace())
+		return position.winsRace() ? WON : LOSS;
+
+	Move moves[Position::MaxMoves];
+	const int count = position.generateMoves(moves);
+
+	// Enhanced transposition cutoff: if any child is already proven lost for
+	// the opponent, this node is won without generating a single subtree
+	for (int i = 0; i < count; ++i) {
+		position.makeMove(moves[i]);
+		Outcome childOutcome;
+		bool proven = probeOutcome(position, childOutcome);
+		bool wins = proven && parentOutcome(position, side, childOutcome) == WON;
+		position.unmakeMove(moves[i]);
+
+		if (wins) {
+			Algorithm::MoveStep step = Algorithm::toMoveStep(moves[i]);
+			visual.push(step);
+			visual.push(Algorithm::MoveStep {step.to, step.from, step.playerNumber});
+			pv.clear(ply + 1);
+			pv.update(ply, moves[i]);
+			storeOutcome(position, WON);
+			return WON;
+		}
+	}
+
+	for (int i = 0; i < count; ++i) {
+		Algorithm::MoveStep step = Algorithm::toMoveStep(moves[i]);
+
+		// Add move to visual queue for visualization
+		visual.push(step);
+
+		// Recursively evaluate the position after this move
+		position.makeMove(moves[i]);
+		Outcome result = parentOutcome(position, side, recusionMove(position, pv, visual, ply + 1));
+		position.unmakeMove(moves[i]);
+
+		// Add revert move to visual queue for visualization
+		visual.push(Algorithm::MoveStep {step.to, step.from, step.playerNumber});
+
+		// Keep the first move's line in case nothing wins
+		if (result == WON || i == 0)
+			pv.update(ply, moves[i]);
+
+		if (result == WON) {
+			storeOutcome(position, WON);
+			return WON;
+		}
+	}
+
+	// No winning path found, return LOSS
+	storeOutcome(position, LOSS);
+	return LOSS;
+}
+
+// Attempts to play the next move for the player in the game state
+bool Algorithm::playNextMove(GameState &state, Player &player, PrincipalVariation &line, std::queue<MoveStep> &visual, int maxDepth = 0, int moveNum) {
+	// A depth limit selects the iterative-deepening search over the exhaustive solver
+	if (maxDepth > 0) {
+		SearchConfig config;
+		config.maxDepth = maxDepth;
+		SearchStats stats;
+		return playNextMove(state, player, line, visual, config, stats);
+	}
+
+	// Explore moves on a compact copy of the game state
+	Position position = toPosition(state, player);
+	PvTable pv;
+	recusionMove(position, pv, visual, 0);
+	pv.extract(line);
+	return line.length > 0;
+}
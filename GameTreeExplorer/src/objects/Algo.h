@@ -1,9 +1,15 @@
 #ifndef ALGO_H
 #define ALGO_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <queue>
-#include <stack>
+#include <stop_token>
 #include <utility>
+#include <vector>
+#include "Position.h"
+#include "TranspositionTable.h"
 class GameState;
 class Player;
 class GameBoard;
@@ -27,11 +33,121 @@ struct MoveStep {
 	int playerNumber;              // Identifier for the player making the move
 };
 
+// Best line found by a search, as compact moves starting with the move to play
+struct PrincipalVariation {
+	static constexpr int MaxLength = 64;
+	int length = 0;
+	Move moves[MaxLength];
+};
+
 // Attempts to play the next move in the game for the given player
-// Uses a history stack to keep track of moves and a visual queue for move visualization
+// Fills line with the best line found and a visual queue for move visualization
 // maxDepth limits the depth of move exploration, moveNum tracks the current move number
-// Returns true if a move was successfully played, false otherwise
-bool playNextMove(GameState &gameState, Player &player, std::stack<MoveStep> &history, std::queue<MoveStep> &visual, int maxDepth, int moveNum = 0);
+// A positive maxDepth runs the iterative-deepening search instead of the exhaustive solver
+// Returns true if a move was found, false otherwise
+bool playNextMove(GameState &gameState, Player &player, PrincipalVariation &line, std::queue<MoveStep> &visual, int maxDepth, int moveNum = 0);
+
+// Score of a position proven won for the side to move
+constexpr int WinScore = 1000000;
+
+// Search backends playNextMove can use
+enum class Engine {
+	AlphaBeta,     // Iterative-deepening alpha-beta with a heuristic evaluation
+	ProofNumber,   // Best-first proof-number search for an exact win/loss answer
+	DepthFirstProofNumber, // df-pn search bounded by a fixed-size hash table
+	MonteCarlo,    // UCT Monte Carlo graph search, for boards too large to search exactly
+};
+
+struct SearchResult;
+
+// Settings for the iterative-deepening search driver
+struct SearchConfig {
+	Engine engine = Engine::AlphaBeta; // Backend used by playNextMove
+	bool useGameTables = true;     // Look positions up in a solved game table when one exists
+	bool useOpeningBook = true;    // Play book moves when an opening book exists
+	int maxDepth = 64;             // Deepest iteration to run
+	int timeLimitMs = 1000;        // Time budget per search, 0 means unlimited
+	bool aspiration = true;        // Start iterations with a window around the previous score
+	int aspirationWindow = 30;     // Initial half-width of the aspiration window
+	int aspirationGrowth = 2;      // Factor the window grows by after a fail-high/low
+	bool lateMoveReductions = true; // Search late-ordered moves shallower first
+	int lmrMinDepth = 3;           // Remaining depth needed before reducing
+	int lmrFullMoves = 3;          // Moves per node always searched to full depth
+	std::size_t pnsMaxNodes = 1 << 21; // Node budget of the proof-number search tree
+	std::size_t dfpnMemoryMb = 256;  // Size of the df-pn hash table, its only storage
+	std::size_t mctsMemoryMb = 128; // Size of the Monte Carlo node and edge pools, which never grow
+	double mctsExploration = 1.4;  // UCT exploration constant
+	int mctsRaveEquivalence = 300; // Visits at which a move's own and RAVE win rates weigh the same, 0 turns RAVE off
+	int mctsThreads = 0;           // Threads sharing the Monte Carlo graph, 0 uses every core
+	std::uint32_t mctsRootPlayouts = 128; // Batched playouts seeding each root move before the search
+	int multiPv = 3;               // Root moves ranked by analyzePosition
+	std::stop_token stop;          // Ends the search like running out of time once a stop is requested
+	std::function<void(const SearchResult &)> onProgress; // Receives the best result so far whenever it improves
+};
+
+// Counters collected during a search
+struct SearchStats {
+	std::uint64_t nodes = 0;       // Positions visited
+	int depth = 0;                 // Deepest fully completed iteration
+	int researches = 0;            // Iterations searched again with a wider window
+	int failHighs = 0;             // Aspiration searches that failed high
+	int failLows = 0;              // Aspiration searches that failed low
+	std::uint64_t reductions = 0;  // Moves searched with a late move reduction
+	std::uint64_t lmrResearches = 0; // Reduced moves that failed high and were searched again
+	int timeMs = 0;                // Wall time spent searching
+};
+
+// Outcome of a search: the chosen move and its score for the side to move
+// A proven score is a sure win or loss. Alpha-beta and the tables score it WinScore minus
+// the plies to the end of the game, the other engines plain +/-WinScore. Alpha-beta only
+// vouches for the distance once its completed depth covers it and late move reductions
+// are off: otherwise it may report a longer win or a shorter loss than best play gives
+struct SearchResult {
+	bool hasMove = false;          // False if the side to move has no legal move
+	Move bestMove {};
+	int score = 0;
+	PrincipalVariation line;       // Expected continuation starting with bestMove
+	bool proven = false;           // True if score is a sure win/loss rather than an estimate
+	SearchStats stats;
+};
+
+// Builds the compact position of the game with the given player to move
+Position toPosition(GameState &state, Player &player);
+
+// Converts a compact move to board coordinates
+MoveStep toMoveStep(const Move &move);
+
+// Converts a move between board coordinates to a compact move
+Move toMove(const MoveStep &step);
+
+// Iterative-deepening alpha-beta search with aspiration windows at the root
+SearchResult iterativeDeepening(const Position &position, const SearchConfig &config);
+
+// Iterative-deepening alpha-beta search of the config.multiPv best root moves
+// Returns one result per move, best first, each with its own score and line
+std::vector<SearchResult> multiPvSearch(const Position &position, const SearchConfig &config);
+
+// Table of positions proven won or lost by the solvers, kept across bot turns
+TranspositionTable &solverTable();
+
+// Table of depth-limited alpha-beta results, kept across bot turns
+// Searches of later turns, and pondering on the opponent's turn, start from what it knows
+TranspositionTable &searchTable();
+
+// Answers from a solved game table or the opening book, otherwise searches with config.engine
+SearchResult searchPosition(const Position &position, const SearchConfig &config);
+
+// Ranks the config.multiPv best root moves for analysis, best first, each with its line
+// The Monte Carlo engine ranks the root moves of its graph, the others use multiPvSearch
+// Unlike searchPosition, tables and the book are not consulted
+std::vector<SearchResult> analyzePosition(const Position &position, const SearchConfig &config);
+
+// Queues a line and its takeback for the board to preview, ending on the real position
+void previewLine(const PrincipalVariation &line, std::queue<MoveStep> &visual);
+
+// Plays the next move using the engine selected in config
+// line receives the principal variation, and stats receives the search counters
+bool playNextMove(GameState &gameState, Player &player, PrincipalVariation &line, std::queue<MoveStep> &visual, const SearchConfig &config, SearchStats &stats);
 
 // Determines the next best move for the player given the current game state
 // Returns the coordinates of the best move as a pair of integers
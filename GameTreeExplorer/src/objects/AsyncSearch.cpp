@@ -0,0 +1,70 @@
+#include "AsyncSearch.h"
+#include <condition_variable>
+#include <mutex>
+
+// State shared by a handle and its worker, which may outlive each other
+struct Algorithm::SearchHandle::State {
+	mutable std::mutex mutex;
+	mutable std::condition_variable finished;
+	SearchResult best;
+	bool done = false;
+};
+
+Algorithm::SearchHandle::SearchHandle() = default;
+Algorithm::SearchHandle::~SearchHandle() = default;
+Algorithm::SearchHandle::SearchHandle(SearchHandle &&) noexcept = default;
+Algorithm::SearchHandle &Algorithm::SearchHandle::operator=(SearchHandle &&) noexcept = default;
+
+bool Algorithm::SearchHandle::isDone() const {
+	if (!state)
+		return false;
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->done;
+}
+
+Algorithm::SearchResult Algorithm::SearchHandle::bestSoFar() const {
+	if (!state)
+		return SearchResult {};
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->best;
+}
+
+Algorithm::SearchResult Algorithm::SearchHandle::wait() const {
+	if (!state)
+		return SearchResult {};
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [this] { return state->done; });
+	return state->best;
+}
+
+void Algorithm::SearchHandle::cancel() {
+	worker.request_stop();
+}
+
+// Runs searchPosition on a new thread, with the thread's stop token in the config and
+// every progress report kept in the handle before it goes on to the caller's callback
+Algorithm::SearchHandle Algorithm::startSearch(const Position &position, const SearchConfig &config) {
+	SearchHandle handle;
+	handle.state = std::make_shared<SearchHandle::State>();
+	handle.worker = std::jthread([state = handle.state, position, settings = config](std::stop_token stop) mutable {
+		auto report = std::move(settings.onProgress);
+		settings.stop = stop;
+		settings.onProgress = [&state, &report](const SearchResult &progress) {
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->best = progress;
+			}
+			if (report)
+				report(progress);
+		};
+
+		const SearchResult result = searchPosition(position, settings);
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->best = result;
+			state->done = true;
+		}
+		state->finished.notify_all();
+	});
+	return handle;
+}
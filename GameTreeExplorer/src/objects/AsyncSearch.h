@@ -0,0 +1,55 @@
+#ifndef ASYNCSEARCH_H
+#define ASYNCSEARCH_H
+
+#include <memory>
+#include <thread>
+#include "Algo.h"
+#include "Position.h"
+
+namespace Algorithm {
+// Search running on a worker thread, started by startSearch
+// The handle always knows the best result reported so far, and the final one once the
+// search is over. Destroying or reassigning a handle cancels its search and waits for
+// the worker, which takes no longer than the engine's next stop check
+class SearchHandle {
+private:
+	struct State;
+
+	std::shared_ptr<State> state;
+	std::jthread worker;
+
+	friend SearchHandle startSearch(const Position &position, const SearchConfig &config);
+
+public:
+	SearchHandle();
+	~SearchHandle();
+	SearchHandle(SearchHandle &&) noexcept;
+	SearchHandle &operator=(SearchHandle &&) noexcept;
+
+	// True once a search was started on this handle
+	bool isStarted() const { return state != nullptr; }
+
+	// True once the search is over, finished or cancelled
+	bool isDone() const;
+
+	// Best result reported so far, the final result once done
+	// Empty while an engine has nothing to report yet
+	SearchResult bestSoFar() const;
+
+	// Waits for the search to end and returns its final result
+	SearchResult wait() const;
+
+	// Asks the search to stop; it still ends with the best result it has
+	void cancel();
+};
+
+// Starts searching the position with searchPosition on a worker thread and returns at once
+// config is copied. Its onProgress callback, if any, is called on the worker thread
+// Alpha-beta reports every finished iteration and Monte Carlo its best line every 100ms;
+// the proof-number engines only have an answer at the end
+// Each engine checks the handle's stop request alongside config.timeLimitMs
+SearchHandle startSearch(const Position &position, const SearchConfig &config);
+
+} // namespace Algorithm
+
+#endif // ASYNCSEARCH_H
@@ -0,0 +1,282 @@
+#include "BatchPlayout.h"
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+// One unsigned 32-bit value per game of a batch
+// The kernel is written once against this type; each instruction set gets its own
+// implementation and the plain C++ one is the fallback. Masks are all ones or all zeros
+#if defined(__AVX512F__)
+struct Lanes {
+	static constexpr int Width = 16;
+	__m512i v;
+
+	static Lanes all(std::uint32_t value) { return {_mm512_set1_epi32(static_cast<int>(value))}; }
+	static Lanes load(const std::uint32_t *values) { return {_mm512_loadu_si512(values)}; }
+	void store(std::uint32_t *values) const { _mm512_storeu_si512(values, v); }
+
+	friend Lanes operator+(Lanes a, Lanes b) { return {_mm512_add_epi32(a.v, b.v)}; }
+	friend Lanes operator-(Lanes a, Lanes b) { return {_mm512_sub_epi32(a.v, b.v)}; }
+	friend Lanes operator*(Lanes a, Lanes b) { return {_mm512_mullo_epi32(a.v, b.v)}; }
+	friend Lanes operator&(Lanes a, Lanes b) { return {_mm512_and_si512(a.v, b.v)}; }
+	friend Lanes operator|(Lanes a, Lanes b) { return {_mm512_or_si512(a.v, b.v)}; }
+	friend Lanes operator^(Lanes a, Lanes b) { return {_mm512_xor_si512(a.v, b.v)}; }
+	Lanes operator~() const { return {_mm512_xor_si512(v, _mm512_set1_epi32(-1))}; }
+	Lanes operator<<(int count) const { return {_mm512_slli_epi32(v, count)}; }
+	Lanes operator>>(int count) const { return {_mm512_srli_epi32(v, count)}; }
+	// Per-lane shifts, counts of 32 and more give 0
+	friend Lanes shiftLeft(Lanes a, Lanes count) { return {_mm512_sllv_epi32(a.v, count.v)}; }
+	friend Lanes shiftRight(Lanes a, Lanes count) { return {_mm512_srlv_epi32(a.v, count.v)}; }
+	friend Lanes equal(Lanes a, Lanes b) { return fromMask(_mm512_cmpeq_epi32_mask(a.v, b.v)); }
+	// Signed comparison, the kernel only compares small values
+	friend Lanes less(Lanes a, Lanes b) { return fromMask(_mm512_cmplt_epi32_mask(a.v, b.v)); }
+	friend Lanes select(Lanes mask, Lanes a, Lanes b) { return {_mm512_ternarylogic_epi32(mask.v, a.v, b.v, 0xCA)}; }
+	bool any() const { return _mm512_test_epi32_mask(v, v) != 0; }
+
+private:
+	static Lanes fromMask(__mmask16 mask) { return {_mm512_maskz_mov_epi32(mask, _mm512_set1_epi32(-1))}; }
+};
+#elif defined(__AVX2__)
+struct Lanes {
+	static constexpr int Width = 8;
+	__m256i v;
+
+	static Lanes all(std::uint32_t value) { return {_mm256_set1_epi32(static_cast<int>(value))}; }
+	static Lanes load(const std::uint32_t *values) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values))}; }
+	void store(std::uint32_t *values) const { _mm256_storeu_si256(reinterpret_cast<__m256i *>(values), v); }
+
+	friend Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_epi32(a.v, b.v)}; }
+	friend Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_epi32(a.v, b.v)}; }
+	friend Lanes operator*(Lanes a, Lanes b) { return {_mm256_mullo_epi32(a.v, b.v)}; }
+	friend Lanes operator&(Lanes a, Lanes b) { return {_mm256_and_si256(a.v, b.v)}; }
+	friend Lanes operator|(Lanes a, Lanes b) { return {_mm256_or_si256(a.v, b.v)}; }
+	friend Lanes operator^(Lanes a, Lanes b) { return {_mm256_xor_si256(a.v, b.v)}; }
+	Lanes operator~() const { return {_mm256_xor_si256(v, _mm256_set1_epi32(-1))}; }
+	Lanes operator<<(int count) const { return {_mm256_slli_epi32(v, count)}; }
+	Lanes operator>>(int count) const { return {_mm256_srli_epi32(v, count)}; }
+	// Per-lane shifts, counts of 32 and more give 0
+	friend Lanes shiftLeft(Lanes a, Lanes count) { return {_mm256_sllv_epi32(a.v, count.v)}; }
+	friend Lanes shiftRight(Lanes a, Lanes count) { return {_mm256_srlv_epi32(a.v, count.v)}; }
+	friend Lanes equal(Lanes a, Lanes b) { return {_mm256_cmpeq_epi32(a.v, b.v)}; }
+	// Signed comparison, the kernel only compares small values
+	friend Lanes less(Lanes a, Lanes b) { return {_mm256_cmpgt_epi32(b.v, a.v)}; }
+	friend Lanes select(Lanes mask, Lanes a, Lanes b) { return {_mm256_blendv_epi8(b.v, a.v, mask.v)}; }
+	bool any() const { return !_mm256_testz_si256(v, v); }
+};
+#else
+struct Lanes {
+	static constexpr int Width = 8;
+	std::uint32_t v[Width];
+
+	template <typename Op>
+	static Lanes map(Op op) {
+		Lanes result;
+		for (int i = 0; i < Width; ++i)
+			result.v[i] = op(i);
+		return result;
+	}
+
+	static Lanes all(std::uint32_t value) { return map([=](int) { return value; }); }
+	static Lanes load(const std::uint32_t *values) { return map([=](int i) { return values[i]; }); }
+	void store(std::uint32_t *values) const {
+		for (int i = 0; i < Width; ++i)
+			values[i] = v[i];
+	}
+
+	friend Lanes operator+(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] + b.v[i]; }); }
+	friend Lanes operator-(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] - b.v[i]; }); }
+	friend Lanes operator*(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] * b.v[i]; }); }
+	friend Lanes operator&(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] & b.v[i]; }); }
+	friend Lanes operator|(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] | b.v[i]; }); }
+	friend Lanes operator^(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] ^ b.v[i]; }); }
+	Lanes operator~() const { return map([&](int i) { return ~v[i]; }); }
+	Lanes operator<<(int count) const { return map([&](int i) { return v[i] << count; }); }
+	Lanes operator>>(int count) const { return map([&](int i) { return v[i] >> count; }); }
+	// Per-lane shifts, counts of 32 and more give 0
+	friend Lanes shiftLeft(Lanes a, Lanes count) {
+		return map([&](int i) { return count.v[i] < 32 ? a.v[i] << count.v[i] : 0u; });
+	}
+	friend Lanes shiftRight(Lanes a, Lanes count) {
+		return map([&](int i) { return count.v[i] < 32 ? a.v[i] >> count.v[i] : 0u; });
+	}
+	friend Lanes equal(Lanes a, Lanes b) { return map([&](int i) { return a.v[i] == b.v[i] ? ~0u : 0u; }); }
+	// Signed comparison, the kernel only compares small values
+	friend Lanes less(Lanes a, Lanes b) {
+		return map([&](int i) { return static_cast<std::int32_t>(a.v[i]) < static_cast<std::int32_t>(b.v[i]) ? ~0u : 0u; });
+	}
+	friend Lanes select(Lanes mask, Lanes a, Lanes b) { return map([&](int i) { return (a.v[i] & mask.v[i]) | (b.v[i] & ~mask.v[i]); }); }
+	bool any() const {
+		std::uint32_t bits = 0;
+		for (int i = 0; i < Width; ++i)
+			bits |= v[i];
+		return bits != 0;
+	}
+};
+#endif
+
+constexpr int Width = Lanes::Width;
+
+// A batch of games played out from the same position, one per lane
+// blocked[p][i] has bit c set when the cell at coordinate c on the line of player p's
+// token i holds an opponent token. Tokens of one player never share a line, so these
+// masks are the whole board as far as moves are concerned
+class PlayoutBatch {
+private:
+	int size;
+	int tokens;
+	Lanes coord[2][Position::MaxTokens];
+	Lanes blocked[2][Position::MaxTokens];
+	Lanes finished[2];
+	Lanes side;          // Player to move, 0 or 1
+	Lanes running;       // Mask of the games still being played
+	Lanes random;        // xorshift32 state of every lane
+
+	Lanes nextRandom() {
+		random = random ^ (random << 13);
+		random = random ^ (random >> 17);
+		random = random ^ (random << 5);
+		return random;
+	}
+
+public:
+	PlayoutBatch(const Position &position, std::uint64_t seed)
+		: size(position.getSize()), tokens(position.getTokenCount()) {
+		for (int player = 0; player < 2; ++player) {
+			for (int token = 0; token < tokens; ++token) {
+				std::uint32_t mask = 0;
+				for (int other = 0; other < tokens; ++other) {
+					if (position.getCoord(1 - player, other) == token + 1)
+						mask |= 1u << (other + 1);
+				}
+				coord[player][token] = Lanes::all(static_cast<std::uint32_t>(position.getCoord(player, token)));
+				blocked[player][token] = Lanes::all(mask);
+			}
+			finished[player] = Lanes::all(static_cast<std::uint32_t>(position.getFinishedCount(player)));
+		}
+		side = Lanes::all(static_cast<std::uint32_t>(position.getSideToMove()));
+		running = Lanes::all(position.isGameOver() ? 0u : ~0u);
+
+		std::uint32_t seeds[Width];
+		for (int lane = 0; lane < Width; ++lane) {
+			seed += 0x9E3779B97F4A7C15ull;
+			const std::uint32_t mixed = static_cast<std::uint32_t>((seed ^ (seed >> 29)) * 0xBF58476D1CE4E5B9ull >> 32);
+			seeds[lane] = mixed | 1;
+		}
+		random = Lanes::load(seeds);
+	}
+
+	// Plays every game to its end and returns the half points scored by player in each lane
+	Lanes play(int player) {
+		const Lanes zero = Lanes::all(0);
+		const Lanes one = Lanes::all(1);
+		const Lanes two = Lanes::all(2);
+		const Lanes last = Lanes::all(static_cast<std::uint32_t>(size - 1));
+		const Lanes tokenCount = Lanes::all(static_cast<std::uint32_t>(tokens));
+		const Lanes scorer = Lanes::all(static_cast<std::uint32_t>(player));
+		Lanes score = zero;
+
+		Lanes target[2][Position::MaxTokens];
+		Lanes weight[2][Position::MaxTokens];
+		for (int ply = 0; ply < Position::MaxGameLength && running.any(); ++ply) {
+			// Moves of both players in every lane: a step if the next cell is free,
+			// otherwise a jump if the cell after it is free
+			Lanes total[2] = {zero, zero};
+			for (int p = 0; p < 2; ++p) {
+				for (int token = 0; token < tokens; ++token) {
+					const Lanes from = coord[p][token];
+					const Lanes line = blocked[p][token];
+					const Lanes stepFree = equal(shiftRight(line, from + one) & one, zero);
+					const Lanes jumpFree = equal(shiftRight(line, from + two) & one, zero);
+					const Lanes movable = ~equal(from, last) & (stepFree | jumpFree);
+					const Lanes to = select(stepFree, from + one, from + two);
+					const Lanes strong = ~stepFree | equal(to, last);
+					target[p][token] = to;
+					weight[p][token] = movable & (one + (strong & one));
+					total[p] = total[p] + weight[p][token];
+				}
+			}
+
+			// The side to move passes if it is stuck and the opponent is not
+			const Lanes sideStuck = equal(select(equal(side, one), total[1], total[0]), zero);
+			const Lanes mover = select(sideStuck, one - side, side);
+			const Lanes moverIsOne = equal(mover, one);
+			const Lanes moverTotal = select(moverIsOne, total[1], total[0]);
+			const Lanes deadEnd = running & equal(total[0] | total[1], zero);
+			const Lanes apply = running & ~deadEnd;
+			score = score + (deadEnd & one);
+			running = running & ~deadEnd;
+
+			// Weighted pick: the token whose weight range holds a random number below the total
+			Lanes remaining = (((nextRandom() >> 16) * moverTotal) >> 16);
+			Lanes taken = ~apply;
+			Lanes chosen = zero;
+			Lanes from = zero;
+			Lanes to = zero;
+			for (int token = 0; token < tokens; ++token) {
+				const Lanes w = select(moverIsOne, weight[1][token], weight[0][token]);
+				const Lanes take = less(remaining, w) & ~taken;
+				taken = taken | take;
+				remaining = remaining - w;
+				chosen = select(take, Lanes::all(static_cast<std::uint32_t>(token)), chosen);
+				from = (select(moverIsOne, coord[1][token], coord[0][token]) & take) | from;
+				to = (select(moverIsOne, target[1][token], target[0][token]) & take) | to;
+				coord[0][token] = select(take & ~moverIsOne, target[0][token], coord[0][token]);
+				coord[1][token] = select(take & moverIsOne, target[1][token], coord[1][token]);
+			}
+
+			// The moved token leaves the line of the opponent token at its old coordinate
+			// and enters the one at its new coordinate
+			const Lanes bit = shiftLeft(one, chosen + one) & apply;
+			for (int token = 0; token < tokens; ++token) {
+				const Lanes line = Lanes::all(static_cast<std::uint32_t>(token + 1));
+				const Lanes flip = (equal(line, from) | equal(line, to)) & bit;
+				blocked[0][token] = blocked[0][token] ^ (flip & moverIsOne);
+				blocked[1][token] = blocked[1][token] ^ (flip & ~moverIsOne);
+			}
+
+			const Lanes arrived = equal(to, last) & apply & one;
+			finished[0] = finished[0] + (arrived & ~moverIsOne);
+			finished[1] = finished[1] + (arrived & moverIsOne);
+			const Lanes won = apply & equal(select(moverIsOne, finished[1], finished[0]), tokenCount);
+			score = score + (won & equal(mover, scorer) & two);
+			running = running & ~won;
+			side = select(apply, one - mover, side);
+		}
+		return score;
+	}
+};
+} // namespace
+
+int Algorithm::playoutBatchWidth() {
+	return Width;
+}
+
+// Plays batches of random games and adds up the half points of player
+std::uint64_t Algorithm::batchPlayouts(const Position &position, int player, std::uint32_t games, std::uint64_t seed) {
+	std::uint64_t points = 0;
+	std::uint32_t scores[Width];
+	for (std::uint32_t played = 0; played < games; played += Width) {
+		PlayoutBatch batch(position, seed + played);
+		batch.play(player).store(scores);
+		const std::uint32_t lanes = games - played < Width ? games - played : Width;
+		for (std::uint32_t lane = 0; lane < lanes; ++lane)
+			points += scores[lane];
+	}
+	return points;
+}
+
+// Estimates the win rate of every legal move with batched playouts
+int Algorithm::rankMovesByPlayouts(const Position &position, std::uint32_t gamesPerMove, Move *moves, double *winRates,
+								   std::uint64_t seed) {
+	const int count = position.generateMoves(moves);
+	for (int i = 0; i < count; ++i) {
+		Position next = position;
+		next.makeMove(moves[i]);
+		const std::uint64_t points = batchPlayouts(next, moves[i].player, gamesPerMove, seed + i * 0x9E3779B97F4A7C15ull);
+		winRates[i] = gamesPerMove > 0 ? 0.5 * static_cast<double>(points) / gamesPerMove : 0.5;
+	}
+	return count;
+}
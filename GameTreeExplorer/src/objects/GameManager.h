@@ -7,12 +7,16 @@
 #include <SFML/System/Time.hpp>
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/VideoMode.hpp>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <ostream>
 #include <queue>
 #include <stack>
+#include <vector>
 #include "Algo.h"
+#include "AsyncSearch.h"
+#include "MonteCarlo.h"
 #include "GameSate.h"
 #include "GameBoard.h"
 
@@ -44,7 +48,10 @@ sf::Font font;               // Font used for win text
 
 std::string player1Name;     // Name of player 1
 std::string player2Name;     // Name of player 2
-std::stack<Algorithm::MoveStep> history; // Stack to keep move history for undo/visualization
+Algorithm::SearchConfig searchConfig; // Time budget and window settings for the bot's search
+Algorithm::SearchHandle botSearch;    // The bot's search, running while the window keeps drawing
+Algorithm::SearchHandle ponderSearch; // Search of the human's position while they think
+int ponderedMs = 0;                   // Time spent pondering since the bot last moved
 
 // Handles selection of a token at the given grid position
 void TokenSelection(const sf::Vector2i &gridPos)
@@ -88,9 +95,14 @@ void TokenMove(const sf::Vector2i &gridPos)
 {
     try
     {
+        const Algorithm::MoveStep step{{selectedPosition.x, selectedPosition.y}, {gridPos.x, gridPos.y},
+                                       state.getCurrentPlayer().getPlayerNumber()};
+        stopPondering();
         state.moveToken(
             selectedPosition.x, selectedPosition.y,
             gridPos.x, gridPos.y);
+        // Keep the bot's search tree below the move the human played
+        Algorithm::monteCarloTree().advance(Algorithm::toMove(step));
 
         checkWinCondition();
         checkOtherPlayerMoves();
@@ -159,22 +171,74 @@ void checkOtherPlayerMoves()
     state.switchPlayer();
 }
 
+// Searches the human's position without a time limit until they move
+// Every reply gets searched, so whichever move comes is already in the Monte Carlo graph
+// and the alpha-beta and solver tables
+void startPondering()
+{
+    Algorithm::SearchConfig ponderConfig = searchConfig;
+    ponderConfig.timeLimitMs = 0;
+    ponderSearch = Algorithm::startSearch(Algorithm::toPosition(state, state.getCurrentPlayer()), ponderConfig);
+}
+
+// Ends pondering before the game moves on; its results stay in the engines' tables
+void stopPondering()
+{
+    if (!ponderSearch.isStarted())
+        return;
+    ponderSearch.cancel();
+    const Algorithm::SearchResult result = ponderSearch.wait();
+    ponderSearch = Algorithm::SearchHandle();
+    ponderedMs += result.stats.timeMs;
+    std::cout << "Pondered " << result.stats.nodes << " nodes to depth " << result.stats.depth
+              << " in " << result.stats.timeMs << "ms" << std::endl;
+}
+
+// Starts the bot's search of the current position
+// Time spent pondering counts toward its budget, down to a quarter of it, since most of
+// what the bot needs was found then
+void startBotSearch()
+{
+    Algorithm::SearchConfig botConfig = searchConfig;
+    if (botConfig.timeLimitMs > 0)
+        botConfig.timeLimitMs = std::max(botConfig.timeLimitMs / 4, botConfig.timeLimitMs - ponderedMs);
+    ponderedMs = 0;
+    botSearch = Algorithm::startSearch(Algorithm::toPosition(state, state.getCurrentPlayer()), botConfig);
+}
+
 // Handles SFML window events such as closing and mouse clicks
+// On the bot's turn its search runs on a worker thread, so the window stays responsive,
+// and on the human's turn the bot ponders the position on one
 void handleEvents()
 {
-	// If current player is bot, handle bot turn
-	if (state.getCurrentPlayer().getPlayerNumber() == 1)  {
-		handleAlgoTurn();
-		return;
-	}
-	
+	// If current player is bot, start its search and play once it is done
+	const bool botTurn = state.getCurrentPlayer().getPlayerNumber() == 1;
+	if (botTurn && !botSearch.isStarted())
+		startBotSearch();
+	else if (!botTurn && !Won && !ponderSearch.isStarted())
+		startPondering();
+
     while (auto event = window.pollEvent())
     {
         if (event->is<sf::Event::Closed>())
         {
+            // Closing doesn't wait for the bot to finish thinking
+            botSearch.cancel();
+            ponderSearch.cancel();
             window.close();
         }
 
+        // Clicks are ignored while the bot thinks
+        if (botTurn)
+            continue;
+
+        // A shows the best moves for the human, ranked with their lines
+        if (auto *keyPress = event->getIf<sf::Event::KeyPressed>())
+        {
+            if (keyPress->code == sf::Keyboard::Key::A)
+                showAnalysis();
+        }
+
         if (auto *mousePress = event->getIf<sf::Event::MouseButtonPressed>())
         {
             const auto mousePos = sf::Mouse::getPosition(window);
@@ -192,14 +256,16 @@ void handleEvents()
             }
         }
     }
+
+	if (botTurn && window.isOpen() && botSearch.isDone())
+		handleAlgoTurn();
 }
 
-// Handles the bot player's turn by calculating and visualizing moves
-void handleAlgoTurn() {
+// Plays a line and its takeback over the real board
+void previewOnBoard(const Algorithm::PrincipalVariation &line)
+{
 	std::queue<Algorithm::MoveStep> visualizeMoves;
-	Algorithm::playNextMove(state, state.getCurrentPlayer(), history, visualizeMoves, 0);	
-
-	Algorithm::MoveStep nextStep;
+	Algorithm::previewLine(line, visualizeMoves);
 
 	const int base_delay_ms = 500;
 	const int base_grid = 3;
@@ -218,15 +284,49 @@ void handleAlgoTurn() {
 		sf::sleep(sf::microseconds(static_cast<int>(delay)));
 	}
 
-	while (!history.empty()) {
-		auto i = history.top();
-		history.pop();
-		nextStep = i;
-	}
-
 	state.getBoard().draw(window, settings.cellSize, settings.cellSize, false);
+}
+
+// Ranks the human's best moves with the bot's engine, prints them and previews each line
+// Pondering is paused for it, both use the same tables
+void showAnalysis()
+{
+    stopPondering();
+    const std::vector<Algorithm::SearchResult> lines =
+        Algorithm::analyzePosition(Algorithm::toPosition(state, state.getCurrentPlayer()), searchConfig);
+    if (lines.empty())
+        return;
 
+    std::cout << "Analysis to depth " << lines[0].stats.depth << " in " << lines[0].stats.timeMs << "ms:" << std::endl;
+    for (std::size_t rank = 0; rank < lines.size(); ++rank)
+    {
+        std::cout << "  " << rank + 1 << ". score " << lines[rank].score << (lines[rank].proven ? " (proven)" : "") << ":";
+        for (int i = 0; i < lines[rank].line.length; ++i)
+        {
+            const Algorithm::MoveStep step = Algorithm::toMoveStep(lines[rank].line.moves[i]);
+            std::cout << " (" << step.from.first << "," << step.from.second << ")-(" << step.to.first << "," << step.to.second << ")";
+        }
+        std::cout << std::endl;
+        previewOnBoard(lines[rank].line);
+    }
+}
+
+// Handles the bot player's turn by visualizing and playing the move its search found
+void handleAlgoTurn() {
+	const Algorithm::SearchResult result = botSearch.wait();
+	botSearch = Algorithm::SearchHandle();
+	const Algorithm::PrincipalVariation &line = result.line;
+	const Algorithm::SearchStats &stats = result.stats;
+	std::cout << "Bot searched " << stats.nodes << " nodes to depth " << stats.depth
+	          << " in " << stats.timeMs << "ms (" << stats.researches << " re-searches)" << std::endl;
+	previewOnBoard(line);
+
+	if (line.length == 0)
+		return;
+	// Play the first move of the principal variation
+	Algorithm::MoveStep nextStep = Algorithm::toMoveStep(line.moves[0]);
 	state.moveToken(nextStep.from.first, nextStep.from.second, nextStep.to.first, nextStep.to.second);
+	Algorithm::monteCarloTree().advance(line.moves[0]);
 
 	checkWinCondition();
 	checkOtherPlayerMoves();
@@ -282,6 +382,9 @@ window(settings.videoMode, "Token Game"), state(settings.cellSize, settings.cell
 player1Name = player1;
 player2Name = player2;
 window.setFramerateLimit(60);
+// Boards this large can't be searched deeply enough in time, let playouts decide
+if (gameSize >= 12)
+    searchConfig.engine = Algorithm::Engine::MonteCarlo;
 }
 
 
@@ -0,0 +1,581 @@
+#include "GameTable.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+const char FileMagic[4] = {'G', 'T', 'B', 'L'};
+
+const std::size_t MinMatch = 4;
+
+// Header at the start of a table file
+// It is followed by the block index (blockCount + 1 offsets into the payload)
+// and the payload of compressed blocks. Fields use the native (little-endian) byte order
+struct FileHeader {
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t boardSize;
+	std::uint32_t tokenCount;
+	std::uint64_t entryCount;
+	std::uint64_t checksum; // FNV-1a of the entry of every rank
+	std::uint32_t blockRanks;
+	std::uint32_t valueBits; // GameTable::Encoding
+	std::uint64_t blockCount;
+};
+static_assert(sizeof(FileHeader) == 48, "Block index must start 8-byte aligned");
+
+// Adds one value to an FNV-1a checksum
+std::uint64_t checksum(std::uint64_t hash, std::uint8_t value) {
+	return (hash ^ value) * 0x100000001B3ull;
+}
+const std::uint64_t ChecksumSeed = 0xCBF29CE484222325ull;
+
+// Reads the entry of a rank from a block packed with the given bits per rank
+std::uint8_t unpack(const std::uint8_t *packed, std::uint64_t index, int bits) {
+	const std::uint64_t bit = index * bits;
+	return static_cast<std::uint8_t>((packed[bit / 8] >> (bit % 8)) & ((1u << bits) - 1));
+}
+
+// Entries of Distance tables are 0 when unknown, otherwise 1 + plies * 2, plus 1 for a loss.
+// An entry of 0 plies doubles as the WinLoss value
+static_assert(2 * (GameTable::MaxSize - 2) * (GameTable::MaxSize - 1) * 2 + 2 <= 255,
+		"Longest game must fit in an entry");
+
+std::uint8_t encodeEntry(GameTable::Value value, int plies) {
+	return static_cast<std::uint8_t>(1 + plies * 2 + (value == GameTable::Loss));
+}
+
+GameTable::Value entryValue(std::uint8_t entry) {
+	if (entry == 0)
+		return GameTable::Unknown;
+	return (entry - 1) % 2 ? GameTable::Loss : GameTable::Win;
+}
+
+int entryPlies(std::uint8_t entry) {
+	return entry == 0 ? -1 : (entry - 1) / 2;
+}
+
+// Writes a length continuation: bytes of 255 followed by the remainder
+void writeLength(std::vector<std::uint8_t> &out, std::size_t length) {
+	for (; length >= 255; length -= 255)
+		out.push_back(255);
+	out.push_back(static_cast<std::uint8_t>(length));
+}
+
+// Compresses a block with a small LZ77 coder
+// Every sequence is a token byte (literal count << 4 | match length - MinMatch),
+// continuation bytes when a nibble is 15, the literals, then a 2-byte match offset.
+// The last sequence holds only literals
+void compressBlock(const std::uint8_t *in, std::size_t length, std::vector<std::uint8_t> &out) {
+	const int HashBits = 14;
+	const int MaxChain = 32;
+	std::vector<int> head(1 << HashBits, -1);
+	std::vector<int> previous(length, -1);
+	auto hash = [in](std::size_t at) {
+		std::uint32_t word;
+		std::memcpy(&word, in + at, sizeof(word));
+		return (word * 2654435761u) >> (32 - HashBits);
+	};
+	auto insert = [&](std::size_t at) {
+		const std::uint32_t key = hash(at);
+		previous[at] = head[key];
+		head[key] = static_cast<int>(at);
+	};
+	auto writeSequence = [&out](const std::uint8_t *literals, std::size_t literalCount, std::size_t matchLength) {
+		out.push_back(static_cast<std::uint8_t>(std::min<std::size_t>(literalCount, 15) << 4 |
+				std::min<std::size_t>(matchLength, 15)));
+		if (literalCount >= 15)
+			writeLength(out, literalCount - 15);
+		out.insert(out.end(), literals, literals + literalCount);
+	};
+
+	std::size_t anchor = 0;
+	std::size_t at = 0;
+	while (at + MinMatch <= length) {
+		// Longest earlier match along the hash chain
+		std::size_t bestLength = 0;
+		std::size_t bestOffset = 0;
+		int candidate = head[hash(at)];
+		for (int chain = 0; candidate >= 0 && chain < MaxChain; ++chain, candidate = previous[candidate]) {
+			std::size_t matched = 0;
+			while (at + matched < length && in[candidate + matched] == in[at + matched])
+				++matched;
+			if (matched > bestLength) {
+				bestLength = matched;
+				bestOffset = at - candidate;
+			}
+		}
+		insert(at);
+		if (bestLength < MinMatch) {
+			++at;
+			continue;
+		}
+
+		writeSequence(in + anchor, at - anchor, bestLength - MinMatch);
+		out.push_back(static_cast<std::uint8_t>(bestOffset & 0xFF));
+		out.push_back(static_cast<std::uint8_t>(bestOffset >> 8));
+		if (bestLength - MinMatch >= 15)
+			writeLength(out, bestLength - MinMatch - 15);
+		for (std::size_t next = at + 1; next < at + bestLength && next + MinMatch <= length; ++next)
+			insert(next);
+		at += bestLength;
+		anchor = at;
+	}
+	writeSequence(in + anchor, length - anchor, 0);
+}
+
+// Decompresses a block written by compressBlock, returns false if it is malformed
+bool decompressBlock(const std::uint8_t *in, std::size_t inSize, std::uint8_t *out, std::size_t outSize) {
+	std::size_t read = 0;
+	std::size_t written = 0;
+	auto readLength = [&](std::size_t &length) {
+		std::uint8_t byte;
+		do {
+			if (read == inSize)
+				return false;
+			byte = in[read++];
+			length += byte;
+		} while (byte == 255);
+		return true;
+	};
+
+	while (read < inSize) {
+		const std::uint8_t token = in[read++];
+		std::size_t literals = token >> 4;
+		if (literals == 15 && !readLength(literals))
+			return false;
+		if (literals > inSize - read || literals > outSize - written)
+			return false;
+		std::memcpy(out + written, in + read, literals);
+		read += literals;
+		written += literals;
+		if (read == inSize)
+			break;
+
+		if (inSize - read < 2)
+			return false;
+		const std::size_t offset = in[read] | in[read + 1] << 8;
+		read += 2;
+		std::size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(matchLength))
+			return false;
+		matchLength += MinMatch;
+		if (offset == 0 || offset > written || matchLength > outSize - written)
+			return false;
+		if (offset >= matchLength) {
+			std::memcpy(out + written, out + written - offset, matchLength);
+			written += matchLength;
+		} else {
+			// Byte by byte, since the match overlaps the bytes it produces
+			for (std::size_t i = 0; i < matchLength; ++i, ++written)
+				out[written] = out[written - offset];
+		}
+	}
+	return written == outSize;
+}
+
+// Reads a little-endian offset of the block index
+std::uint64_t readOffset(const std::uint8_t *index, std::uint64_t block) {
+	std::uint64_t offset;
+	std::memcpy(&offset, index + block * sizeof(offset), sizeof(offset));
+	return offset;
+}
+
+// Number of different armies (coordinates of all tokens of one player)
+std::uint64_t armyCount(int boardSize) {
+	std::uint64_t count = 1;
+	for (int i = 0; i < boardSize - 2; ++i)
+		count *= boardSize;
+	return count;
+}
+
+// Number of ranks of a board size: one per unordered pair of armies and side to move,
+// and one per army played against itself
+std::uint64_t rankCount(int boardSize) {
+	return armyCount(boardSize) * armyCount(boardSize);
+}
+
+// Rank of the position where player 0 has the first army and player 1 the second
+// Twins swap the armies and the side to move, so ranks go to first < second with
+// either side to move, and to equal armies with player 0 to move
+std::uint64_t pairRank(std::uint64_t first, std::uint64_t second, int side, std::uint64_t armies) {
+	if (first > second || (first == second && side == 1)) {
+		std::swap(first, second);
+		side = 1 - side;
+	}
+	if (first == second)
+		return armies * (armies - 1) + first;
+	return (second * (second - 1) / 2 + first) * 2 + side;
+}
+
+// Places a player's tokens at the coordinates of an army
+void placeArmy(Position &position, int player, std::uint64_t army) {
+	for (int token = position.getTokenCount() - 1; token >= 0; --token) {
+		position.setCoord(player, token, static_cast<int>(army % position.getSize()));
+		army /= position.getSize();
+	}
+}
+
+// Entry of a position for its side to move, given the entries of all higher ranks
+// The winner picks the fastest win, the loser the slowest loss
+std::uint8_t solvePosition(Position &position, const std::vector<std::uint8_t> &entries) {
+	const int side = position.getSideToMove();
+	if (position.hasWon(side))
+		return encodeEntry(GameTable::Win, 0);
+	if (position.hasWon(1 - side))
+		return encodeEntry(GameTable::Loss, 0);
+
+	int fastestWin = -1;
+	int slowestLoss = 0;
+	Move moves[Position::MaxMoves];
+	const int count = position.generateMoves(moves);
+	for (int i = 0; i < count; ++i) {
+		position.makeMove(moves[i]);
+		const std::uint8_t child = entries[GameTable::rank(position)];
+		const bool sameSide = position.getSideToMove() == side;
+		position.unmakeMove(moves[i]);
+
+		const int plies = entryPlies(child) + 1;
+		if (entryValue(child) == (sameSide ? GameTable::Win : GameTable::Loss)) {
+			if (fastestWin == -1 || plies < fastestWin)
+				fastestWin = plies;
+		} else {
+			slowestLoss = std::max(slowestLoss, plies);
+		}
+	}
+	if (fastestWin != -1)
+		return encodeEntry(GameTable::Win, fastestWin);
+	return encodeEntry(GameTable::Loss, slowestLoss);
+}
+
+// Calls visit(layout) for every layout that starts with the given digits
+// and whose remaining digits add up to sum
+template <typename Visit>
+void forEachLayout(int size, int digit, int digits, int sum, std::uint64_t prefix, const Visit &visit) {
+	if (digit == digits) {
+		if (sum == 0)
+			visit(prefix);
+		return;
+	}
+	const int restMax = (digits - digit - 1) * (size - 1);
+	for (int coord = std::max(0, sum - restMax); coord <= std::min(sum, size - 1); ++coord)
+		forEachLayout(size, digit + 1, digits, sum - coord, prefix * size + coord, visit);
+}
+} // namespace
+
+// Least recently used decompressed blocks of a mapped table
+// Probes may come from several search threads, so lookups are serialized
+struct GameTable::BlockCache {
+	struct Block {
+		std::uint64_t number;
+		std::vector<std::uint8_t> packed;
+	};
+	std::mutex mutex;
+	std::list<Block> blocks; // Most recently used first
+	std::map<std::uint64_t, std::list<Block>::iterator> lookup;
+};
+
+// Constructor creating an unsolved table for the given board size
+GameTable::GameTable(int boardSize) : size(boardSize), count(0) {
+	if (boardSize < 3 || boardSize > MaxSize)
+		throw std::out_of_range("Board size not supported by game tables");
+	count = rankCount(boardSize);
+	storage.assign(count, Unknown);
+}
+
+// Constructor wrapping a mapped table file whose header was checked
+GameTable::GameTable(int boardSize, Encoding bits, MappedFile mapped, std::uint64_t blocks)
+	: size(boardSize), count(rankCount(boardSize)), encoding(bits), file(std::move(mapped)), blockCount(blocks),
+	  blockIndex(file.data() + sizeof(FileHeader)), payload(blockIndex + (blocks + 1) * sizeof(std::uint64_t)),
+	  cache(std::make_unique<BlockCache>()) {}
+
+GameTable::GameTable(GameTable &&) noexcept = default;
+GameTable &GameTable::operator=(GameTable &&) noexcept = default;
+GameTable::~GameTable() = default;
+
+// Returns the rank of a position, shared with its twin
+std::uint64_t GameTable::rank(const Position &position) {
+	std::uint64_t armies[2] = {0, 0};
+	for (int player = 0; player < 2; ++player) {
+		for (int token = 0; token < position.getTokenCount(); ++token)
+			armies[player] = armies[player] * position.getSize() + position.getCoord(player, token);
+	}
+	return pairRank(armies[0], armies[1], position.getSideToMove(), armyCount(position.getSize()));
+}
+
+// Rebuilds the position of the pair with the given rank that has the lower army for player 0
+Position GameTable::unrank(int boardSize, std::uint64_t rank) {
+	const std::uint64_t armies = armyCount(boardSize);
+	std::uint64_t first = rank - armies * (armies - 1);
+	std::uint64_t second = first;
+	int side = 0;
+	if (rank < armies * (armies - 1)) {
+		// Invert pair = second * (second - 1) / 2 + first with first < second
+		const std::uint64_t pair = rank / 2;
+		side = static_cast<int>(rank % 2);
+		second = static_cast<std::uint64_t>(std::sqrt(2.0 * static_cast<double>(pair)));
+		while (second * (second - 1) / 2 > pair)
+			--second;
+		while ((second + 1) * second / 2 <= pair)
+			++second;
+		first = pair - second * (second - 1) / 2;
+	}
+
+	Position position(boardSize);
+	placeArmy(position, 0, first);
+	placeArmy(position, 1, second);
+	position.setSideToMove(side);
+	return position;
+}
+
+// Checks that no two tokens of a position share a cell
+bool GameTable::isValid(const Position &position) {
+	// Player 0 token i sits on row i + 1, player 1 token j on column j + 1
+	for (int token = 0; token < position.getTokenCount(); ++token) {
+		const int x = position.getCoord(0, token);
+		if (x >= 1 && x <= position.getTokenCount() && position.getCoord(1, x - 1) == token + 1)
+			return false;
+	}
+	return true;
+}
+
+// Solves every position of the board size bottom-up
+// Positions are split into layers by the sum of all token coordinates. Every move
+// adds 1 or 2 to that sum, so a layer only reads layers above it and all of its
+// layouts can be solved in parallel without locks
+GameTable GameTable::solve(int boardSize, int threads) {
+	GameTable table(boardSize);
+	if (threads <= 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	const int digits = 2 * (boardSize - 2);
+	const int splitDigits = std::min(3, digits);
+	std::uint64_t workItems = 1;
+	for (int i = 0; i < splitDigits; ++i)
+		workItems *= boardSize;
+
+	for (int layer = digits * (boardSize - 1); layer >= 0; --layer) {
+		// Work items are the values of the leading digits, handed out through an atomic counter
+		std::atomic<std::uint64_t> nextItem {0};
+		auto worker = [&]() {
+			for (std::uint64_t item = nextItem++; item < workItems; item = nextItem++) {
+				int prefixSum = 0;
+				for (std::uint64_t rest = item; rest > 0; rest /= boardSize)
+					prefixSum += static_cast<int>(rest % boardSize);
+				if (prefixSum > layer)
+					continue;
+				forEachLayout(boardSize, splitDigits, digits, layer - prefixSum, item,
+						[&table](std::uint64_t layout) { table.solveLayout(layout); });
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (int i = 1; i < threads; ++i)
+			pool.emplace_back(worker);
+		worker();
+		for (auto &thread : pool)
+			thread.join();
+	}
+	return table;
+}
+
+// Solves both sides to move of one token layout
+// They are solved together since a side without moves passes and takes
+// the inverted value of the other side
+void GameTable::solveLayout(std::uint64_t layout) {
+	// Layouts with the larger army for player 0 are twins of layouts solved elsewhere,
+	// and with equal armies player 1 to move is the twin of player 0 to move
+	const std::uint64_t armies = armyCount(size);
+	const std::uint64_t first = layout / armies;
+	const std::uint64_t second = layout % armies;
+	if (first > second)
+		return;
+	Position position(size);
+	placeArmy(position, 0, first);
+	placeArmy(position, 1, second);
+	if (!isValid(position))
+		return;
+
+	const int sides = first == second ? 1 : 2;
+	int passingSide = -1;
+	for (int side = 0; side < sides; ++side) {
+		position.setSideToMove(side);
+		if (!position.isGameOver() && !position.hasMoves(side)) {
+			passingSide = side;
+			continue;
+		}
+		storage[rank(position)] = solvePosition(position, storage);
+	}
+
+	if (passingSide != -1 && sides == 2) {
+		position.setSideToMove(1 - passingSide);
+		const std::uint8_t other = storage[rank(position)];
+		position.setSideToMove(passingSide);
+		if (other != 0)
+			storage[rank(position)] = encodeEntry(entryValue(other) == Win ? Loss : Win, entryPlies(other));
+	}
+}
+
+// Returns the stored value of a position
+GameTable::Value GameTable::probe(const Position &position) const {
+	const std::uint8_t stored = entry(rank(position));
+	return encoding == WinLoss ? static_cast<Value>(stored) : entryValue(stored);
+}
+
+// Returns the plies left until the game ends when both sides play well
+int GameTable::pliesToEnd(const Position &position) const {
+	return encoding == WinLoss ? -1 : entryPlies(entry(rank(position)));
+}
+
+// Returns the stored entry of a rank, 0 if it is unknown
+std::uint8_t GameTable::entry(std::uint64_t index) const {
+	if (!file.isOpen())
+		return storage[index];
+
+	const std::uint64_t block = index / BlockRanks;
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	auto found = cache->lookup.find(block);
+	if (found != cache->lookup.end()) {
+		cache->blocks.splice(cache->blocks.begin(), cache->blocks, found->second);
+	} else {
+		// Reuse the least recently used block once the cache is full
+		if (cache->blocks.size() < CachedBlocks) {
+			cache->blocks.push_front(BlockCache::Block{block, std::vector<std::uint8_t>(blockBytes())});
+		} else {
+			cache->lookup.erase(cache->blocks.back().number);
+			cache->blocks.splice(cache->blocks.begin(), cache->blocks, std::prev(cache->blocks.end()));
+			cache->blocks.front().number = block;
+		}
+		if (!readBlock(block, cache->blocks.front().packed.data())) {
+			cache->blocks.pop_front();
+			return 0;
+		}
+		found = cache->lookup.emplace(block, cache->blocks.begin()).first;
+	}
+	return unpack(found->second->packed.data(), index % BlockRanks, encoding);
+}
+
+// Decompresses a block of a mapped table into packed entries
+bool GameTable::readBlock(std::uint64_t block, std::uint8_t *packed) const {
+	const std::uint64_t begin = readOffset(blockIndex, block);
+	const std::uint64_t end = readOffset(blockIndex, block + 1);
+	const std::uint64_t payloadSize = file.size() - (payload - file.data());
+	if (begin > end || end > payloadSize)
+		return false;
+	return decompressBlock(payload + begin, end - begin, packed, blockBytes());
+}
+
+// Writes the table to a file with the given encoding, returns false on failure
+bool GameTable::save(const std::string &path, Encoding bits) const {
+	if (storage.empty())
+		return false;
+	FileHeader header {};
+	std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+	header.version = FileVersion;
+	header.boardSize = size;
+	header.tokenCount = size - 2;
+	header.entryCount = count;
+	header.checksum = ChecksumSeed;
+	header.blockRanks = BlockRanks;
+	header.valueBits = bits;
+	header.blockCount = (count + BlockRanks - 1) / BlockRanks;
+
+	std::vector<std::uint64_t> offsets {0};
+	std::vector<std::uint8_t> blocks;
+	std::vector<std::uint8_t> packed(BlockRanks / 8 * bits);
+	for (std::uint64_t block = 0; block < header.blockCount; ++block) {
+		// The tail of the last block is padded with unknown entries
+		std::fill(packed.begin(), packed.end(), 0);
+		for (std::uint64_t i = 0; i < BlockRanks && block * BlockRanks + i < count; ++i) {
+			std::uint8_t stored = storage[block * BlockRanks + i];
+			if (bits == WinLoss)
+				stored = entryValue(stored);
+			packed[i * bits / 8] |= stored << (i * bits % 8);
+			header.checksum = checksum(header.checksum, stored);
+		}
+		compressBlock(packed.data(), packed.size(), blocks);
+		offsets.push_back(blocks.size());
+	}
+
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+	out.write(reinterpret_cast<const char *>(blocks.data()), blocks.size());
+	return static_cast<bool>(out);
+}
+
+// Maps a table file read-only; blocks are only decompressed when probed
+std::unique_ptr<GameTable> GameTable::open(const std::string &path) {
+	MappedFile mapped;
+	if (!mapped.open(path) || mapped.size() < sizeof(FileHeader))
+		return nullptr;
+
+	FileHeader header;
+	std::memcpy(&header, mapped.data(), sizeof(header));
+	const int boardSize = static_cast<int>(header.boardSize);
+	if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 || header.version != FileVersion ||
+		boardSize < 3 || boardSize > MaxSize || header.tokenCount != header.boardSize - 2 ||
+		header.entryCount != rankCount(boardSize) || header.blockRanks != BlockRanks ||
+		(header.valueBits != WinLoss && header.valueBits != Distance) ||
+		header.blockCount != (header.entryCount + BlockRanks - 1) / BlockRanks)
+		return nullptr;
+
+	// The index must fit, and the last offset must end exactly at the end of the file
+	const std::uint64_t indexSize = (header.blockCount + 1) * sizeof(std::uint64_t);
+	if (mapped.size() - sizeof(header) < indexSize)
+		return nullptr;
+	const std::uint8_t *index = mapped.data() + sizeof(header);
+	if (readOffset(index, header.blockCount) != mapped.size() - sizeof(header) - indexSize)
+		return nullptr;
+	return std::unique_ptr<GameTable>(
+			new GameTable(boardSize, static_cast<Encoding>(header.valueBits), std::move(mapped), header.blockCount));
+}
+
+// Checks the values against the checksum stored in the file header
+bool GameTable::verify() const {
+	if (!file.isOpen())
+		return true;
+	FileHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	std::uint64_t hash = ChecksumSeed;
+	std::vector<std::uint8_t> packed(blockBytes());
+	for (std::uint64_t block = 0; block < blockCount; ++block) {
+		if (!readBlock(block, packed.data()))
+			return false;
+		for (std::uint64_t i = 0; i < BlockRanks && block * BlockRanks + i < count; ++i)
+			hash = checksum(hash, unpack(packed.data(), i, encoding));
+	}
+	return hash == header.checksum;
+}
+
+// File name used for the table of a board size
+std::string GameTable::fileName(int boardSize) {
+	return "gametable_" + std::to_string(boardSize) + ".bin";
+}
+
+// Returns the table for a board size, mapping it from disk on first use
+const GameTable *GameTable::forSize(int boardSize) {
+	static std::map<int, std::unique_ptr<GameTable>> tables;
+	if (boardSize < 3 || boardSize > MaxSize)
+		return nullptr;
+
+	auto found = tables.find(boardSize);
+	if (found == tables.end()) {
+		std::unique_ptr<GameTable> table = open(fileName(boardSize));
+		if (table && table->getSize() != boardSize)
+			table.reset();
+		found = tables.emplace(boardSize, std::move(table)).first;
+	}
+	return found->second.get();
+}
@@ -0,0 +1,127 @@
+#ifndef GAMETABLE_H
+#define GAMETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Position.h"
+
+// Complete table of game values for one board size, computed by retrograde analysis
+// Each player's token coordinates read as digits in base size give its army number.
+// A position and its twin (board transposed, players swapped) have the same value,
+// so only one of each pair gets a rank, which halves the table
+// Entries also hold the number of plies to the end of the game when both sides play
+// well: the winner takes the fastest win and the loser the slowest loss
+// A table is either built in memory by solve() (one byte per rank) or mapped read-only
+// from its file, where entries are packed into compressed blocks
+class GameTable
+{
+public:
+    static constexpr int MaxSize = 7;          // Largest board the retrograde solver handles
+    static constexpr std::uint32_t FileVersion = 4; // Encoding version written to table files
+    static constexpr std::uint32_t BlockRanks = 32768; // Ranks per compressed block
+    static constexpr std::size_t CachedBlocks = 256; // Decompressed blocks kept per mapped table
+
+    // Value of a position for the side to move
+    enum Value : std::uint8_t
+    {
+        Unknown, // Invalid (overlapping tokens) or not solved
+        Win,
+        Loss
+    };
+
+    // Bits stored per rank in a table file
+    enum Encoding : std::uint8_t
+    {
+        WinLoss = 2,  // Values only
+        Distance = 8  // Values and plies to the end of the game
+    };
+
+private:
+    struct BlockCache;
+
+    int size;
+    std::uint64_t count;                // Number of ranks
+    Encoding encoding = Distance;       // What the entries hold
+    std::vector<std::uint8_t> storage;  // Entries of a table built in memory
+    MappedFile file;                    // Mapping of a table opened from disk
+    std::uint64_t blockCount = 0;       // Compressed blocks in the mapped file
+    const std::uint8_t *blockIndex = nullptr; // blockCount + 1 payload offsets
+    const std::uint8_t *payload = nullptr;    // Compressed blocks
+    std::unique_ptr<BlockCache> cache;  // Most recently used decompressed blocks
+
+    // Constructor wrapping a mapped table file whose header was checked
+    GameTable(int boardSize, Encoding bits, MappedFile mapped, std::uint64_t blocks);
+
+    // Bytes of a decompressed block
+    std::size_t blockBytes() const { return BlockRanks / 8 * encoding; }
+
+    // Returns the stored entry of a rank, 0 if it is unknown
+    std::uint8_t entry(std::uint64_t index) const;
+
+    // Decompresses a block of a mapped table into packed entries
+    bool readBlock(std::uint64_t block, std::uint8_t *packed) const;
+
+    // Solves both sides to move of one token layout (player 0's army * armies + player 1's)
+    void solveLayout(std::uint64_t layout);
+
+public:
+    // Constructor creating an unsolved table for the given board size
+    explicit GameTable(int boardSize);
+
+    GameTable(const GameTable &) = delete;
+    GameTable &operator=(const GameTable &) = delete;
+    GameTable(GameTable &&) noexcept;
+    GameTable &operator=(GameTable &&) noexcept;
+    ~GameTable();
+
+    int getSize() const { return size; }
+
+    // Number of ranks in the table
+    std::uint64_t entryCount() const { return count; }
+
+    // Returns the rank of a position, shared with its twin
+    static std::uint64_t rank(const Position &position);
+
+    // Rebuilds the position of the pair with the given rank that has the lower army
+    // for player 0, or player 0 to move if the armies are equal
+    static Position unrank(int boardSize, std::uint64_t rank);
+
+    // Checks that no two tokens of a position share a cell
+    static bool isValid(const Position &position);
+
+    // Returns the stored value of a position
+    // Mapped tables decompress the block holding the rank unless it is cached
+    Value probe(const Position &position) const;
+
+    // Returns the plies left until the game ends when both sides play well,
+    // or -1 if the position is unknown or the table only stores values
+    int pliesToEnd(const Position &position) const;
+
+    // Solves every position of the board size bottom-up on the given number of threads
+    // (0 uses every core). Tokens only move forward, so successors are always solved first
+    static GameTable solve(int boardSize, int threads = 0);
+
+    // Writes the table to a file with the given encoding, returns false on failure
+    bool save(const std::string &path, Encoding bits = Distance) const;
+
+    // Maps a table file read-only; blocks are only decompressed when probed
+    // Returns nullptr if the file is missing or its header doesn't match
+    static std::unique_ptr<GameTable> open(const std::string &path);
+
+    // Checks the values against the checksum stored in the file header
+    // This reads the whole table, so open() leaves it to offline tools
+    bool verify() const;
+
+    // File name used for the table of a board size
+    static std::string fileName(int boardSize);
+
+    // Returns the table for a board size, mapping it from disk on first use
+    // Returns nullptr if no table file exists for that size
+    static const GameTable *forSize(int boardSize);
+};
+
+#endif // GAMETABLE_H
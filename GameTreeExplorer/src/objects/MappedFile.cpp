@@ -0,0 +1,104 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(bytes, other.bytes);
+		std::swap(length, other.length);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+// Maps the file, returns false if it is missing, empty or can't be mapped
+bool MappedFile::open(const std::string &path) {
+	close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	const void *view = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping)
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	bytes = static_cast<const std::uint8_t *>(view);
+	length = static_cast<std::size_t>(fileSize.QuadPart);
+	return true;
+}
+
+// Unmaps the file
+void MappedFile::close() {
+	if (bytes)
+		UnmapViewOfFile(bytes);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+	bytes = nullptr;
+	length = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+#else
+// Maps the file, returns false if it is missing, empty or can't be mapped
+bool MappedFile::open(const std::string &path) {
+	close();
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat info;
+	void *view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+		view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	bytes = static_cast<const std::uint8_t *>(view);
+	length = static_cast<std::size_t>(info.st_size);
+	return true;
+}
+
+// Unmaps the file
+void MappedFile::close() {
+	if (bytes)
+		munmap(const_cast<std::uint8_t *>(bytes), length);
+	bytes = nullptr;
+	length = 0;
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file
+// The pages are shared with every other process mapping the same file and are
+// only read from disk when first touched
+class MappedFile
+{
+private:
+    const std::uint8_t *bytes = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // Maps the file, returns false if it is missing, empty or can't be mapped
+    bool open(const std::string &path);
+
+    // Unmaps the file
+    void close();
+
+    bool isOpen() const { return bytes != nullptr; }
+    const std::uint8_t *data() const { return bytes; }
+    std::size_t size() const { return length; }
+};
+
+#endif // MAPPEDFILE_H
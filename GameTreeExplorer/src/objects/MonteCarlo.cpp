@@ -0,0 +1,809 @@
+#include "MonteCarlo.h"
+#include "BatchPlayout.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr std::uint32_t NoNode = std::numeric_limits<std::uint32_t>::max();
+constexpr std::uint32_t Expanding = NoNode - 1; // First edge of a node another thread is expanding
+constexpr std::uint32_t VirtualLoss = 3;        // Lost visits charged per simulation still running through a node
+constexpr int ScoreScale = 1000; // Score of a position won in every playout
+constexpr std::uint32_t EdgesPerNode = 2;    // Edge pool size relative to the node pool
+constexpr std::uint32_t MaxNodes = 1u << 30; // Keeps the hash index addressable by 32-bit slots
+constexpr std::chrono::milliseconds ProgressInterval {100}; // Time between progress reports
+
+// Compact key of a move for the RAVE statistics: the player, the token and where it lands
+// Tokens only move forward, so a key is played at most once per game
+constexpr int MoveKeys = 2 * Position::MaxTokens * Position::MaxSize;
+constexpr int MoveKeyWords = (MoveKeys + 63) / 64;
+
+int moveKey(const Move &move) {
+	return (move.player * Position::MaxTokens + move.token) * Position::MaxSize + move.to;
+}
+
+// Small xorshift generator, far cheaper than <random> inside playouts
+struct Random {
+	std::uint64_t state;
+
+	std::uint64_t next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+
+	// Uniform number below bound
+	std::uint32_t below(std::uint32_t bound) {
+		return static_cast<std::uint32_t>(((next() >> 32) * bound) >> 32);
+	}
+};
+
+// Winner of a game that is over or decided as a race, -1 while it is still open
+int decidedWinner(const Position &position) {
+	if (position.hasWon(0))
+		return 0;
+	if (position.hasWon(1))
+		return 1;
+	if (position.isRace())
+		return position.winsRace() ? position.getSideToMove() : 1 - position.getSideToMove();
+	return -1;
+}
+} // namespace
+
+// Position of the Monte Carlo graph, shared by all search threads and by every move
+// order that reaches it. Positions are not stored, they are rebuilt by replaying moves
+// from the root. Points are only counted for player 0: a simulation hands out 2 half
+// points in total, so player 1 has the rest
+struct Algorithm::MonteCarloTree::Node {
+	std::atomic<std::uint32_t> visits;    // Finished simulations through the position
+	std::atomic<std::uint32_t> running;   // Simulations through it still in progress
+	std::atomic<std::uint32_t> halfWins;  // Half points of player 0 in the finished simulations
+	std::atomic<std::uint32_t> firstEdge; // NoNode until expanded, the edges are stored next to each other
+	std::uint8_t edgeCount;               // Written before firstEdge is published
+	std::atomic<std::uint8_t> winner;     // 0 while open, otherwise 1 + the player proven to win
+	std::uint64_t key;                    // Zobrist hash, written before the node is published in the index
+
+	void init(std::uint64_t positionKey) {
+		visits.store(0, std::memory_order_relaxed);
+		running.store(0, std::memory_order_relaxed);
+		halfWins.store(0, std::memory_order_relaxed);
+		firstEdge.store(NoNode, std::memory_order_relaxed);
+		edgeCount = 0;
+		winner.store(0, std::memory_order_relaxed);
+		key = positionKey;
+	}
+
+	// Half points of a player in the finished simulations
+	std::uint32_t pointsOf(int player) const {
+		const std::int64_t points = halfWins.load(std::memory_order_relaxed);
+		if (player == 0)
+			return static_cast<std::uint32_t>(points);
+		// Another thread may have added the points of a simulation but not its visit yet
+		const std::int64_t total = 2 * static_cast<std::int64_t>(visits.load(std::memory_order_relaxed));
+		return static_cast<std::uint32_t>(std::max<std::int64_t>(0, total - points));
+	}
+};
+
+// Move from a node to one of its children
+struct Algorithm::MonteCarloTree::Edge {
+	Move move;
+	std::uint32_t child;                     // Written before the parent's firstEdge is published
+	std::atomic<std::uint32_t> amafVisits;   // Simulations through the parent where this move was played later
+	std::atomic<std::uint32_t> amafHalfWins; // Half points of those simulations for the player of the move
+
+	void init(const Move &edgeMove, std::uint32_t childIndex) {
+		move = edgeMove;
+		child = childIndex;
+		amafVisits.store(0, std::memory_order_relaxed);
+		amafHalfWins.store(0, std::memory_order_relaxed);
+	}
+};
+
+// State owned by one search thread
+// Nodes may have several parents, so the walk down from the root is kept to back results up
+struct Algorithm::MonteCarloTree::Worker {
+	Position position;      // Position of the last node on the path
+	Random random;
+	std::uint64_t played[MoveKeyWords]; // Keys of the moves played below the node being backed up
+	int depth;                                        // Edges taken from the root
+	std::uint32_t path[Position::MaxGameLength + 1];  // Nodes from the root to the leaf
+	std::uint32_t pathEdges[Position::MaxGameLength]; // Edges taken between them
+
+	void markPlayed(const Move &move) {
+		const int key = moveKey(move);
+		played[key / 64] |= 1ull << (key % 64);
+	}
+
+	bool wasPlayed(const Move &move) const {
+		const int key = moveKey(move);
+		return (played[key / 64] >> (key % 64)) & 1;
+	}
+};
+
+Algorithm::MonteCarloTree::MonteCarloTree() = default;
+Algorithm::MonteCarloTree::~MonteCarloTree() = default;
+
+// Starts a new graph with the given root
+void Algorithm::MonteCarloTree::reset(const Position &position, std::uint32_t nodeCapacity) {
+	if (nodeCapacity != capacity) {
+		// Nodes and edges are only initialized when handed out. calloc maps a large pool as
+		// zero pages on first touch, so its untouched pages cost nothing, where new[] would
+		// construct every atomic up front
+		capacity = nodeCapacity;
+		edgeCapacity = EdgesPerNode * capacity;
+		std::uint64_t slots = 1;
+		while (slots < 2ull * capacity)
+			slots *= 2;
+		hashMask = static_cast<std::uint32_t>(slots - 1);
+		nodes.reset(static_cast<Node *>(std::calloc(capacity, sizeof(Node))));
+		edges.reset(static_cast<Edge *>(std::calloc(edgeCapacity, sizeof(Edge))));
+		if (!nodes || !edges)
+			throw std::bad_alloc();
+		hashIndex.reset(new std::atomic<std::uint32_t>[slots]);
+		forward.reset(new std::uint32_t[capacity]);
+		edgeForward.reset(new std::uint32_t[edgeCapacity]);
+	}
+	for (std::uint64_t slot = 0; slot <= hashMask; ++slot)
+		hashIndex[slot].store(NoNode, std::memory_order_relaxed);
+	used.store(0, std::memory_order_relaxed);
+	edgesUsed.store(0, std::memory_order_relaxed);
+	root = findOrAdd(position.getHash());
+	rootPosition = position;
+	hasRoot = true;
+}
+
+// Node of the position with the given key, added if it is new, NoNode if the pool is full
+// Slots are probed linearly and claimed by compare-and-swap, so threads adding the same
+// position agree on one node; the loser's node is left for the next compaction
+std::uint32_t Algorithm::MonteCarloTree::findOrAdd(std::uint64_t key) {
+	std::uint32_t added = NoNode;
+	for (std::uint32_t slot = static_cast<std::uint32_t>(key) & hashMask; ; slot = (slot + 1) & hashMask) {
+		std::uint32_t found = hashIndex[slot].load(std::memory_order_acquire);
+		if (found == NoNode) {
+			if (added == NoNode) {
+				added = used.fetch_add(1, std::memory_order_relaxed);
+				if (added >= capacity) {
+					used.store(capacity, std::memory_order_relaxed);
+					return NoNode;
+				}
+				nodes[added].init(key);
+			}
+			if (hashIndex[slot].compare_exchange_strong(found, added, std::memory_order_acq_rel))
+				return added;
+		}
+		if (nodes[found].key == key)
+			return found;
+	}
+}
+
+// Fills the hash index again after the nodes moved
+void Algorithm::MonteCarloTree::rebuildIndex() {
+	for (std::uint64_t slot = 0; slot <= hashMask; ++slot)
+		hashIndex[slot].store(NoNode, std::memory_order_relaxed);
+	const std::uint32_t count = used.load(std::memory_order_relaxed);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		std::uint32_t slot = static_cast<std::uint32_t>(nodes[i].key) & hashMask;
+		while (hashIndex[slot].load(std::memory_order_relaxed) != NoNode)
+			slot = (slot + 1) & hashMask;
+		hashIndex[slot].store(i, std::memory_order_relaxed);
+	}
+}
+
+// UCB1 value of an edge: the win rate of its child for the player of the move plus an
+// exploration bonus that shrinks with visits. Running simulations count as losses
+// With RAVE the win rate is blended with the edge's all-moves-as-first win rate, which
+// carries most of the weight while the child has few visits of its own
+double Algorithm::MonteCarloTree::uct(const Edge &edge, double logParentVisits) const {
+	const Node &child = nodes[edge.child];
+	const std::uint32_t visits = child.visits.load(std::memory_order_relaxed)
+			+ VirtualLoss * child.running.load(std::memory_order_relaxed);
+	if (visits == 0)
+		return std::numeric_limits<double>::infinity();
+	double winRate = 0.5 * child.pointsOf(edge.move.player) / visits;
+
+	const std::uint32_t amafVisits = edge.amafVisits.load(std::memory_order_relaxed);
+	if (config->mctsRaveEquivalence > 0 && amafVisits > 0) {
+		const double equivalence = config->mctsRaveEquivalence;
+		const double beta = std::sqrt(equivalence / (3.0 * visits + equivalence));
+		const double amafRate = 0.5 * edge.amafHalfWins.load(std::memory_order_relaxed) / amafVisits;
+		winRate = (1.0 - beta) * winRate + beta * amafRate;
+	}
+	return winRate + config->mctsExploration * std::sqrt(logParentVisits / visits);
+}
+
+// Walks from the root to a leaf along the best UCT edges, playing their moves on the
+// worker's position, recording the path and counting a running simulation on every
+// node on the way
+// Children proven lost for the side to move are never picked, proven wins always are,
+// and the walk stops at proven nodes
+std::uint32_t Algorithm::MonteCarloTree::select(Worker &worker) {
+	std::uint32_t index = root;
+	worker.depth = 0;
+	worker.path[0] = root;
+	nodes[root].running.fetch_add(1, std::memory_order_relaxed);
+	while (true) {
+		const Node &node = nodes[index];
+		const std::uint32_t first = node.firstEdge.load(std::memory_order_acquire);
+		if (first >= Expanding || node.edgeCount == 0)
+			return index;
+		if (worker.depth > 0 && node.winner.load(std::memory_order_relaxed) != 0)
+			return index;
+
+		const double logVisits = std::log(static_cast<double>(node.visits.load(std::memory_order_relaxed)
+				+ VirtualLoss * node.running.load(std::memory_order_relaxed)));
+		std::uint32_t best = first;
+		double bestValue = -std::numeric_limits<double>::infinity();
+		for (std::uint32_t i = first; i < first + node.edgeCount; ++i) {
+			const int winner = nodes[edges[i].child].winner.load(std::memory_order_relaxed) - 1;
+			double value;
+			if (winner == -1)
+				value = uct(edges[i], logVisits);
+			else if (winner == edges[i].move.player)
+				value = std::numeric_limits<double>::infinity();
+			else
+				continue;
+			if (value > bestValue) {
+				bestValue = value;
+				best = i;
+			}
+		}
+		worker.pathEdges[worker.depth++] = best;
+		index = edges[best].child;
+		worker.path[worker.depth] = index;
+		nodes[index].running.fetch_add(1, std::memory_order_relaxed);
+		worker.position.makeMove(edges[best].move);
+	}
+}
+
+// Creates the edges of a leaf, each linked to the node of its position, new or already
+// in the graph. Returns false if the leaf has no moves, another thread got to it first
+// or the pool is full
+bool Algorithm::MonteCarloTree::expand(Worker &worker, std::uint32_t index) {
+	Node &node = nodes[index];
+	std::uint32_t expected = NoNode;
+	if (!node.firstEdge.compare_exchange_strong(expected, Expanding, std::memory_order_acq_rel))
+		return false;
+
+	Move moves[Position::MaxMoves];
+	const int count = worker.position.generateMoves(moves);
+	const std::uint32_t first = edgesUsed.fetch_add(static_cast<std::uint32_t>(count), std::memory_order_relaxed);
+	bool fits = first + static_cast<std::uint32_t>(count) <= edgeCapacity;
+	for (int i = 0; fits && i < count; ++i) {
+		worker.position.makeMove(moves[i]);
+		const std::uint32_t child = findOrAdd(worker.position.getHash());
+		worker.position.unmakeMove(moves[i]);
+		fits = child != NoNode;
+		if (fits)
+			edges[first + i].init(moves[i], child);
+	}
+	if (!fits) {
+		// Out of room: leave the leaf unexpanded and stop the threads for a collection
+		if (first + static_cast<std::uint32_t>(count) > edgeCapacity)
+			edgesUsed.store(edgeCapacity, std::memory_order_relaxed);
+		full.store(true, std::memory_order_relaxed);
+		stop.store(true, std::memory_order_relaxed);
+		node.firstEdge.store(NoNode, std::memory_order_release);
+		return false;
+	}
+	node.edgeCount = static_cast<std::uint8_t>(count);
+	node.firstEdge.store(first, std::memory_order_release);
+	return count > 0;
+}
+
+// Plays random moves until the game is decided and returns the winner, -1 for a dead end
+// Jumps and finishing moves are twice as likely as plain steps
+int Algorithm::MonteCarloTree::playout(Worker &worker) {
+	Position game = worker.position;
+	while (true) {
+		const int winner = decidedWinner(game);
+		if (winner != -1)
+			return winner;
+		Move moves[Position::MaxMoves];
+		const int count = game.generateMoves(moves);
+		if (count == 0)
+			return -1;
+
+		int weights[Position::MaxMoves];
+		int total = 0;
+		for (int i = 0; i < count; ++i) {
+			const bool strong = moves[i].to - moves[i].from > 1 || moves[i].to == game.getSize() - 1;
+			weights[i] = strong ? 2 : 1;
+			total += weights[i];
+		}
+		int pick = static_cast<int>(worker.random.below(static_cast<std::uint32_t>(total)));
+		int chosen = 0;
+		while (pick >= weights[chosen])
+			pick -= weights[chosen++];
+		worker.markPlayed(moves[chosen]);
+		game.makeMove(moves[chosen]);
+	}
+}
+
+// Proves a node from its children: won for the side to move once one child is won
+// for it, lost once all of them are lost. Returns true if the node is proven
+bool Algorithm::MonteCarloTree::proveFromChildren(std::uint32_t index) {
+	Node &node = nodes[index];
+	if (node.winner.load(std::memory_order_relaxed) != 0)
+		return true;
+	const std::uint32_t first = node.firstEdge.load(std::memory_order_acquire);
+	if (first >= Expanding || node.edgeCount == 0)
+		return false;
+
+	const int mover = edges[first].move.player;
+	bool allLost = true;
+	for (std::uint32_t i = first; i < first + node.edgeCount; ++i) {
+		const int winner = nodes[edges[i].child].winner.load(std::memory_order_relaxed) - 1;
+		if (winner == mover) {
+			node.winner.store(static_cast<std::uint8_t>(mover + 1), std::memory_order_relaxed);
+			return true;
+		}
+		if (winner == -1)
+			allLost = false;
+	}
+	if (allLost)
+		node.winner.store(static_cast<std::uint8_t>(2 - mover), std::memory_order_relaxed);
+	return allLost;
+}
+
+// Adds a simulation result to every node on the worker's path, taking its moves back
+// A proven leaf also tries to prove the nodes above it, up to the first one still open;
+// its other parents find out when a later simulation reaches it through them
+// With RAVE, every edge of a node on the path whose move was played later in the
+// simulation, in the graph or in the playout, gets the result as an AMAF sample
+void Algorithm::MonteCarloTree::backPropagate(Worker &worker, int winner, bool proven) {
+	const bool rave = config->mctsRaveEquivalence > 0;
+	const std::uint32_t points = winner == -1 ? 1 : (winner == 0 ? 2 : 0);
+	for (int depth = worker.depth; depth >= 0; --depth) {
+		const std::uint32_t index = worker.path[depth];
+		Node &node = nodes[index];
+		if (proven && depth < worker.depth)
+			proven = proveFromChildren(index);
+		node.visits.fetch_add(1, std::memory_order_relaxed);
+		node.running.fetch_sub(1, std::memory_order_relaxed);
+		if (points > 0)
+			node.halfWins.fetch_add(points, std::memory_order_relaxed);
+
+		const std::uint32_t first = node.firstEdge.load(std::memory_order_acquire);
+		if (rave && first < Expanding) {
+			for (std::uint32_t i = first; i < first + node.edgeCount; ++i) {
+				Edge &edge = edges[i];
+				if (!worker.wasPlayed(edge.move))
+					continue;
+				edge.amafVisits.fetch_add(1, std::memory_order_relaxed);
+				if (winner == -1)
+					edge.amafHalfWins.fetch_add(1, std::memory_order_relaxed);
+				else if (edge.move.player == winner)
+					edge.amafHalfWins.fetch_add(2, std::memory_order_relaxed);
+			}
+		}
+		if (depth > 0) {
+			const Move &move = edges[worker.pathEdges[depth - 1]].move;
+			worker.markPlayed(move);
+			worker.position.unmakeMove(move);
+		}
+	}
+}
+
+// 2 for a move proven to win for its player, 0 for one proven to lose, 1 otherwise
+int Algorithm::MonteCarloTree::proofRank(const Edge &edge) const {
+	const int winner = nodes[edge.child].winner.load(std::memory_order_relaxed) - 1;
+	return winner == edge.move.player ? 2 : (winner == -1 ? 1 : 0);
+}
+
+// Edge to play from a node, NoNode if it has none: a proven win for the side to move,
+// otherwise the most visited child not proven lost, otherwise the most visited one
+std::uint32_t Algorithm::MonteCarloTree::bestEdge(std::uint32_t index) const {
+	const Node &node = nodes[index];
+	const std::uint32_t first = node.firstEdge.load(std::memory_order_acquire);
+	if (first >= Expanding)
+		return NoNode;
+	std::uint32_t best = NoNode;
+	int bestRank = -1;
+	for (std::uint32_t i = first; i < first + node.edgeCount; ++i) {
+		const Node &child = nodes[edges[i].child];
+		const int rank = proofRank(edges[i]);
+		if (rank > bestRank || (rank == bestRank && child.visits > nodes[edges[best].child].visits)) {
+			best = i;
+			bestRank = rank;
+		}
+	}
+	return best;
+}
+
+// Gives every root move a head start of batched playouts, which cost far less
+// than playouts through the graph
+void Algorithm::MonteCarloTree::seedRoot() {
+	const std::uint32_t games = config->mctsRootPlayouts;
+	if (games == 0)
+		return;
+	Move moves[Position::MaxMoves];
+	double winRates[Position::MaxMoves];
+	const int count = rankMovesByPlayouts(rootPosition, games, moves, winRates, rootPosition.getHash());
+	const std::uint32_t first = nodes[root].firstEdge.load(std::memory_order_relaxed);
+	const int mover = rootPosition.getSideToMove();
+	for (int i = 0; i < count; ++i) {
+		Node &child = nodes[edges[first + i].child];
+		const double points = 2.0 * games * (mover == 0 ? winRates[i] : 1.0 - winRates[i]);
+		child.visits += games;
+		child.halfWins += static_cast<std::uint32_t>(std::lround(points));
+	}
+	nodes[root].visits += games * static_cast<std::uint32_t>(count);
+	playouts += static_cast<std::uint64_t>(games) * count;
+}
+
+// Search loop of one thread, until the pool fills up, time runs out or a stop is requested
+// The reporting thread also hands the best result so far to config.onProgress now and then
+void Algorithm::MonteCarloTree::work(std::uint64_t seed, std::chrono::steady_clock::time_point start, bool reports) {
+	Worker worker {rootPosition, Random {seed}, {}, 0, {}, {}};
+	std::uint64_t count = 0;
+	int deepest = 0;
+	auto nextReport = std::chrono::steady_clock::now() + ProgressInterval;
+	while (!stop.load(std::memory_order_relaxed)) {
+		if ((count & 255) == 0) {
+			const auto now = std::chrono::steady_clock::now();
+			if (config->stop.stop_requested()
+					|| (config->timeLimitMs > 0 && now - start >= std::chrono::milliseconds(config->timeLimitMs))) {
+				stop.store(true, std::memory_order_relaxed);
+				break;
+			}
+			if (reports && config->onProgress && now >= nextReport) {
+				SearchResult progress;
+				extractLine(progress);
+				progress.stats.nodes = nodes[root].visits.load(std::memory_order_relaxed);
+				progress.stats.timeMs = static_cast<int>(
+						std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+				if (progress.hasMove)
+					config->onProgress(progress);
+				nextReport = now + ProgressInterval;
+			}
+		}
+
+		std::fill(std::begin(worker.played), std::end(worker.played), 0);
+		std::uint32_t leaf = select(worker);
+		int winner = worker.depth > 0 ? nodes[leaf].winner.load(std::memory_order_relaxed) - 1 : -1;
+		if (winner == -1)
+			winner = decidedWinner(worker.position);
+		// A leaf is expanded once a simulation has finished there and it looks worth
+		// growing, unless the game is already decided there
+		if (winner == -1 && nodes[leaf].visits.load(std::memory_order_relaxed) > 0 && expand(worker, leaf)) {
+			const std::uint32_t edge = nodes[leaf].firstEdge.load(std::memory_order_relaxed);
+			worker.pathEdges[worker.depth++] = edge;
+			leaf = edges[edge].child;
+			worker.path[worker.depth] = leaf;
+			nodes[leaf].running.fetch_add(1, std::memory_order_relaxed);
+			worker.position.makeMove(edges[edge].move);
+			winner = nodes[leaf].winner.load(std::memory_order_relaxed) - 1;
+			if (winner == -1)
+				winner = decidedWinner(worker.position);
+		}
+
+		// A decided leaf is a proof, backed up like a minimax solver would
+		const bool proven = winner != -1 && worker.depth > 0;
+		if (proven)
+			nodes[leaf].winner.store(static_cast<std::uint8_t>(winner + 1), std::memory_order_relaxed);
+		else
+			winner = playout(worker);
+		deepest = std::max(deepest, worker.depth);
+		backPropagate(worker, winner, proven);
+		if (nodes[root].winner.load(std::memory_order_relaxed) != 0)
+			stop.store(true, std::memory_order_relaxed);
+		++count;
+	}
+
+	playouts.fetch_add(count, std::memory_order_relaxed);
+	int previous = maxDepth.load(std::memory_order_relaxed);
+	while (previous < deepest && !maxDepth.compare_exchange_weak(previous, deepest, std::memory_order_relaxed)) {}
+}
+
+// Follows the most visited children from the root as the expected line
+void Algorithm::MonteCarloTree::extractLine(SearchResult &result) const {
+	const std::uint32_t best = bestEdge(root);
+	if (best == NoNode) {
+		result.hasMove = false;
+		result.line.length = 0;
+		return;
+	}
+	extractLine(best, result);
+}
+
+// Line through a root move, then the most visited children, scored for the side to move
+void Algorithm::MonteCarloTree::extractLine(std::uint32_t rootEdge, SearchResult &result) const {
+	const Edge &first = edges[rootEdge];
+	const Node &child = nodes[first.child];
+	result.line.length = 0;
+	result.hasMove = child.visits > 0;
+	if (!result.hasMove)
+		return;
+
+	result.line.moves[result.line.length++] = first.move;
+	std::uint32_t index = first.child;
+	while (result.line.length < PrincipalVariation::MaxLength) {
+		const std::uint32_t best = bestEdge(index);
+		if (best == NoNode || nodes[edges[best].child].visits == 0)
+			break;
+		result.line.moves[result.line.length++] = edges[best].move;
+		index = edges[best].child;
+	}
+
+	result.bestMove = first.move;
+	const int rank = proofRank(first);
+	if (rank != 1) {
+		result.proven = true;
+		result.score = rank == 2 ? WinScore : -WinScore;
+		return;
+	}
+	const double winRate = 0.5 * child.pointsOf(first.move.player) / child.visits;
+	result.score = static_cast<int>(std::lround((2.0 * winRate - 1.0) * ScoreScale));
+}
+
+// Root moves that were visited, ranked like bestEdge picks the move to play
+std::vector<Algorithm::SearchResult> Algorithm::MonteCarloTree::rankRootMoves(int count) const {
+	std::vector<SearchResult> lines;
+	if (!hasRoot)
+		return lines;
+	const Node &node = nodes[root];
+	const std::uint32_t first = node.firstEdge.load(std::memory_order_acquire);
+	if (first >= Expanding)
+		return lines;
+
+	std::vector<std::uint32_t> ranked;
+	for (std::uint32_t i = first; i < first + node.edgeCount; ++i) {
+		if (nodes[edges[i].child].visits > 0)
+			ranked.push_back(i);
+	}
+	std::stable_sort(ranked.begin(), ranked.end(), [this](std::uint32_t a, std::uint32_t b) {
+		const int rankA = proofRank(edges[a]);
+		const int rankB = proofRank(edges[b]);
+		if (rankA != rankB)
+			return rankA > rankB;
+		return nodes[edges[a].child].visits > nodes[edges[b].child].visits;
+	});
+
+	lines.resize(std::min<std::size_t>(ranked.size(), std::max(count, 1)));
+	for (std::size_t i = 0; i < lines.size(); ++i)
+		extractLine(ranked[i], lines[i]);
+	return lines;
+}
+
+// Searches the position on the configured number of threads
+// A graph whose root is the same position is searched further instead of being rebuilt
+Algorithm::SearchResult Algorithm::MonteCarloTree::search(const Position &position, const SearchConfig &searchConfig) {
+	SearchResult result;
+	if (position.isGameOver())
+		return result;
+
+	const auto start = std::chrono::steady_clock::now();
+	// Each node brings its share of edges and compaction tables. The hash index has a
+	// power of two of slots, at least two per node, so every size it can take is tried
+	// and the one leaving room for the most nodes wins
+	const std::size_t budget = searchConfig.mctsMemoryMb << 20;
+	const std::size_t nodeBytes = sizeof(Node) + sizeof(std::uint32_t)
+			+ EdgesPerNode * (sizeof(Edge) + sizeof(std::uint32_t));
+	std::size_t poolNodes = 0;
+	for (std::size_t slots = 2; slots / 2 <= MaxNodes && slots * sizeof(std::uint32_t) < budget; slots *= 2)
+		poolNodes = std::max(poolNodes, std::min(slots / 2, (budget - slots * sizeof(std::uint32_t)) / nodeBytes));
+	// A collection always keeps the root and its children, which must fit in half the pool
+	const auto nodeCapacity = static_cast<std::uint32_t>(
+			std::clamp<std::size_t>(poolNodes, 2 * (Position::MaxMoves + 1), MaxNodes));
+	const bool reuse = hasRoot && nodeCapacity == capacity && rootPosition.getHash() == position.getHash();
+	if (!reuse)
+		reset(position, nodeCapacity);
+	else if (used.load(std::memory_order_relaxed) > capacity / 2
+			|| edgesUsed.load(std::memory_order_relaxed) > edgeCapacity / 2)
+		collectGarbage();
+
+	config = &searchConfig;
+	playouts.store(0, std::memory_order_relaxed);
+	// Pruning may have taken the children that proved the root, so it is proven again
+	nodes[root].winner.store(0, std::memory_order_relaxed);
+	maxDepth.store(0, std::memory_order_relaxed);
+
+	// The root may be a leaf of the previous graph; it is expanded even when decided,
+	// since a move still has to be picked
+	Worker rootWorker {rootPosition, Random {1}, {}, 0, {}, {}};
+	if (nodes[root].firstEdge.load(std::memory_order_relaxed) == NoNode)
+		expand(rootWorker, root);
+	if (nodes[root].edgeCount > 0) {
+		if (nodes[root].visits.load(std::memory_order_relaxed) == 0)
+			seedRoot();
+		int threads = config->mctsThreads;
+		if (threads <= 0)
+			threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+		// A full pool stops every thread, so the garbage is collected while nobody walks the graph
+		for (int round = 0; ; ++round) {
+			stop.store(false, std::memory_order_relaxed);
+			full.store(false, std::memory_order_relaxed);
+			const std::uint64_t seed = (position.getHash() | 1) + 0x9E3779B97F4A7C15ull * threads * round;
+			std::vector<std::thread> pool;
+			for (int i = 1; i < threads; ++i)
+				pool.emplace_back(&MonteCarloTree::work, this, seed + 0x9E3779B97F4A7C15ull * i, start, false);
+			work(seed, start, true);
+			for (auto &thread : pool)
+				thread.join();
+
+			// Without a time limit or a way to stop it, a full pool is the end of the search
+			if (!full.load() || (config->timeLimitMs <= 0 && !config->stop.stop_possible()))
+				break;
+			collectGarbage();
+		}
+	}
+
+	result.stats.nodes = playouts.load();
+	result.stats.depth = maxDepth.load();
+	result.stats.timeMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count());
+	extractLine(result);
+	config = nullptr;
+
+	// Share a proven root with the other solvers and later turns
+	if (result.proven)
+		solverTable().store(position.getCanonicalHash(), result.score, TranspositionTable::SolvedDepth, TranspositionTable::Exact);
+	return result;
+}
+
+// Moves the root along a move played in the game
+void Algorithm::MonteCarloTree::advance(const Move &move) {
+	if (!hasRoot)
+		return;
+	const Node &node = nodes[root];
+	const std::uint32_t first = node.firstEdge.load(std::memory_order_relaxed);
+	std::uint32_t played = NoNode;
+	if (first < Expanding) {
+		for (std::uint32_t i = first; i < first + node.edgeCount; ++i) {
+			if (edges[i].move.player == move.player && edges[i].move.token == move.token && edges[i].move.to == move.to)
+				played = i;
+		}
+	}
+	if (played == NoNode) {
+		clear();
+		return;
+	}
+	rootPosition.makeMove(edges[played].move);
+	const std::uint32_t newRoot = edges[played].child;
+	std::uint32_t keptEdges;
+	mark(newRoot, 0, keptEdges);
+	compact(newRoot);
+}
+
+// Marks the nodes reachable from newRoot for a compaction, depth first
+// Nodes other than newRoot with fewer than minVisits visits become leaves on the way,
+// which is why a collection can mark again with a higher threshold. Every path is a
+// line of play, so the walk never holds more nodes than the longest game
+std::uint32_t Algorithm::MonteCarloTree::mark(std::uint32_t newRoot, std::uint64_t minVisits, std::uint32_t &keptEdges) {
+	const std::uint32_t count = std::min(used.load(std::memory_order_relaxed), capacity);
+	std::fill(forward.get(), forward.get() + count, NoNode);
+
+	// Whether the walk goes on below a node just reached
+	auto descend = [&](std::uint32_t index) {
+		Node &node = nodes[index];
+		if (node.firstEdge.load(std::memory_order_relaxed) >= Expanding)
+			return false;
+		if (index != newRoot && node.visits.load(std::memory_order_relaxed) < minVisits) {
+			node.firstEdge.store(NoNode, std::memory_order_relaxed);
+			node.edgeCount = 0;
+			return false;
+		}
+		keptEdges += node.edgeCount;
+		return node.edgeCount > 0;
+	};
+
+	std::uint32_t stack[Position::MaxGameLength + 1];
+	std::uint8_t nextEdge[Position::MaxGameLength + 1];
+	int top = -1;
+	keptEdges = 0;
+	forward[newRoot] = 0;
+	std::uint32_t kept = 1;
+	if (descend(newRoot)) {
+		stack[++top] = newRoot;
+		nextEdge[top] = 0;
+	}
+	while (top >= 0) {
+		const Node &node = nodes[stack[top]];
+		if (nextEdge[top] == node.edgeCount) {
+			--top;
+			continue;
+		}
+		const std::uint32_t child = edges[node.firstEdge.load(std::memory_order_relaxed) + nextEdge[top]++].child;
+		if (forward[child] != NoNode)
+			continue;
+		forward[child] = 0;
+		++kept;
+		if (descend(child)) {
+			stack[++top] = child;
+			nextEdge[top] = 0;
+		}
+	}
+	return kept;
+}
+
+// Makes the marked nodes the whole graph
+// Nodes and edge blocks keep their order and slide towards the front, so nothing is
+// overwritten before it has been moved
+void Algorithm::MonteCarloTree::compact(std::uint32_t newRoot) {
+	const std::uint32_t count = std::min(used.load(std::memory_order_relaxed), capacity);
+	const std::uint32_t edgeCount = std::min(edgesUsed.load(std::memory_order_relaxed), edgeCapacity);
+	std::uint32_t kept = 0;
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (forward[i] != NoNode)
+			forward[i] = kept++;
+	}
+
+	// The first edge of every kept block notes its owner until the block has moved
+	std::fill(edgeForward.get(), edgeForward.get() + edgeCount, NoNode);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const std::uint32_t first = nodes[i].firstEdge.load(std::memory_order_relaxed);
+		if (forward[i] != NoNode && first < Expanding && nodes[i].edgeCount > 0)
+			edgeForward[first] = i;
+	}
+	std::uint32_t keptEdges = 0;
+	for (std::uint32_t i = 0; i < edgeCount; ) {
+		if (edgeForward[i] == NoNode) {
+			++i;
+			continue;
+		}
+		const std::uint32_t size = nodes[edgeForward[i]].edgeCount;
+		edgeForward[i] = keptEdges;
+		for (std::uint32_t j = 0; j < size; ++j) {
+			Edge &from = edges[i + j];
+			Edge &to = edges[keptEdges + j];
+			to.move = from.move;
+			to.child = forward[from.child];
+			to.amafVisits.store(from.amafVisits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			to.amafHalfWins.store(from.amafHalfWins.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		keptEdges += size;
+		i += size;
+	}
+
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (forward[i] == NoNode)
+			continue;
+		Node &from = nodes[i];
+		Node &to = nodes[forward[i]];
+		std::uint32_t first = from.firstEdge.load(std::memory_order_relaxed);
+		// A node expanded without moves keeps an empty edge range
+		if (first < Expanding)
+			first = from.edgeCount > 0 ? edgeForward[first] : 0;
+		to.visits.store(from.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		to.running.store(0, std::memory_order_relaxed);
+		to.halfWins.store(from.halfWins.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		to.firstEdge.store(first, std::memory_order_relaxed);
+		to.edgeCount = from.edgeCount;
+		to.winner.store(from.winner.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		to.key = from.key;
+	}
+	used.store(kept, std::memory_order_relaxed);
+	edgesUsed.store(keptEdges, std::memory_order_relaxed);
+	root = forward[newRoot];
+	rebuildIndex();
+}
+
+// Prunes the least visited parts of the graph until at most half of each pool is in use
+// The visit threshold doubles until enough nodes go; the root's children always stay
+void Algorithm::MonteCarloTree::collectGarbage() {
+	std::uint64_t minVisits = 2;
+	std::uint32_t keptEdges;
+	// Past the root's visits only the root and its children are left, so raising the
+	// threshold further can't prune anything more
+	while ((mark(root, minVisits, keptEdges) > capacity / 2 || keptEdges > edgeCapacity / 2)
+			&& minVisits <= nodes[root].visits.load(std::memory_order_relaxed))
+		minVisits *= 2;
+	compact(root);
+}
+
+// Searches the position with a fresh graph
+Algorithm::SearchResult Algorithm::monteCarloTreeSearch(const Position &position, const SearchConfig &config) {
+	MonteCarloTree tree;
+	return tree.search(position, config);
+}
+
+// Graph used by playNextMove, kept across turns
+Algorithm::MonteCarloTree &Algorithm::monteCarloTree() {
+	static MonteCarloTree tree;
+	return tree;
+}
@@ -0,0 +1,125 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "Algo.h"
+#include "Position.h"
+
+namespace Algorithm {
+// UCT Monte Carlo graph search for boards too large to search exactly
+// Grows a graph of move statistics from lightly biased random playouts until
+// config.timeLimitMs runs out, then plays the most visited move. The score is the win
+// rate scaled to [-1000, 1000]
+// Move orders reaching the same position share its node, found in a hash index on the
+// Zobrist key, so every simulation through a position informs all the lines leading
+// there and transpositions take no extra room
+// Nodes and edges live in pools of config.mctsMemoryMb megabytes addressed by 32-bit
+// indices. When they fill up, the graph below rarely visited nodes is pruned and the
+// pools are compacted, so a search of any length keeps the same footprint. Without a
+// time limit the search ends when the pools are full instead, unless config.stop can end it
+// config.mctsThreads threads grow the same graph, so playouts scale with the cores
+// Root moves start with config.mctsRootPlayouts batched playouts each
+// Moves are also rated by RAVE: the results of every simulation where the same token
+// reached the same cell later on, which tell good forward moves apart after few visits
+// Decided positions are proofs: wins and losses are backed up like a minimax solver,
+// proven branches are no longer sampled, and a proven root ends the search with an
+// exact score of +/-WinScore
+class MonteCarloTree {
+private:
+	struct Node;
+	struct Edge;
+	struct Worker;
+
+	// Releases a pool taken from calloc
+	struct FreePool {
+		void operator()(void *pool) const { std::free(pool); }
+	};
+
+	// Fixed pools, never reallocated while threads run
+	std::unique_ptr<Node[], FreePool> nodes;
+	std::unique_ptr<Edge[], FreePool> edges; // The edges of a node are stored next to each other
+	std::unique_ptr<std::atomic<std::uint32_t>[]> hashIndex; // Open addressing table of nodes by Zobrist key
+	std::unique_ptr<std::uint32_t[]> forward;     // New index of every node during a compaction
+	std::unique_ptr<std::uint32_t[]> edgeForward; // New index of every edge block during a compaction
+	std::uint32_t capacity = 0;
+	std::uint32_t edgeCapacity = 0;
+	std::uint32_t hashMask = 0;
+	std::atomic<std::uint32_t> used {0};      // Nodes handed out from the pool
+	std::atomic<std::uint32_t> edgesUsed {0}; // Edges handed out from the pool
+	std::uint32_t root = 0;                   // Node of rootPosition, anywhere in the pool
+	Position rootPosition;
+	bool hasRoot = false;
+
+	// State of the search in progress
+	const SearchConfig *config = nullptr;
+	std::atomic<bool> stop {false};
+	std::atomic<bool> full {false};        // Set when an expansion found a pool full
+	std::atomic<std::uint64_t> playouts {0};
+	std::atomic<int> maxDepth {0};
+
+	// Starts a new graph with the given root
+	void reset(const Position &position, std::uint32_t nodeCapacity);
+
+	// Node of the position with the given key, added if it is new, NoNode if the pool is full
+	std::uint32_t findOrAdd(std::uint64_t key);
+	void rebuildIndex();
+
+	double uct(const Edge &edge, double logParentVisits) const;
+	std::uint32_t select(Worker &worker);
+	bool expand(Worker &worker, std::uint32_t index);
+	static int playout(Worker &worker);
+	bool proveFromChildren(std::uint32_t index);
+	void backPropagate(Worker &worker, int winner, bool proven);
+	int proofRank(const Edge &edge) const;
+	std::uint32_t bestEdge(std::uint32_t index) const;
+	void seedRoot();
+	void work(std::uint64_t seed, std::chrono::steady_clock::time_point start, bool reports);
+	void extractLine(SearchResult &result) const;
+	void extractLine(std::uint32_t rootEdge, SearchResult &result) const;
+
+	// Marks the nodes reachable from newRoot, turning nodes other than newRoot with fewer
+	// than minVisits visits into leaves, and returns the number of nodes and edges it keeps
+	std::uint32_t mark(std::uint32_t newRoot, std::uint64_t minVisits, std::uint32_t &keptEdges);
+
+	// Makes the marked nodes the whole graph, sliding them to the front of the pools
+	void compact(std::uint32_t newRoot);
+
+	// Prunes the least visited parts until at most half of each pool is in use
+	void collectGarbage();
+
+public:
+	MonteCarloTree();
+	~MonteCarloTree();
+
+	MonteCarloTree(const MonteCarloTree &) = delete;
+	MonteCarloTree &operator=(const MonteCarloTree &) = delete;
+
+	// Searches the position, continuing from the current graph if its root is the same position
+	SearchResult search(const Position &position, const SearchConfig &config);
+
+	// Moves the root along a move played in the game, keeping only what is reachable from it
+	// The graph is dropped if it didn't reach that move yet
+	void advance(const Move &move);
+
+	// The count best root moves of the last search, ranked like the move it plays, each
+	// with its own line and score
+	std::vector<SearchResult> rankRootMoves(int count) const;
+
+	// Drops the whole graph
+	void clear() { hasRoot = false; }
+};
+
+// Searches the position with a fresh graph
+SearchResult monteCarloTreeSearch(const Position &position, const SearchConfig &config);
+
+// Graph used by playNextMove, kept across turns so each turn starts from the last one
+MonteCarloTree &monteCarloTree();
+
+} // namespace Algorithm
+
+#endif // MONTECARLO_H
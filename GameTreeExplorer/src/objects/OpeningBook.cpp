@@ -0,0 +1,93 @@
+#include "OpeningBook.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <utility>
+
+namespace {
+const char FileMagic[4] = {'G', 'B', 'O', 'K'};
+
+// Header at the start of a book file, followed by the entries sorted by key
+// Fields use the native (little-endian) byte order
+struct FileHeader {
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t boardSize;
+	std::uint32_t entrySize;
+	std::uint64_t entryCount;
+	std::uint64_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32, "Entries must start 8-byte aligned");
+static_assert(sizeof(OpeningBook::Entry) == 16, "Book entries are written as they are laid out");
+} // namespace
+
+// Constructor wrapping a mapped book file whose header was checked
+OpeningBook::OpeningBook(int boardSize, MappedFile mapped)
+	: size(boardSize), entries(reinterpret_cast<const Entry *>(mapped.data() + sizeof(FileHeader))),
+	  count((mapped.size() - sizeof(FileHeader)) / sizeof(Entry)), file(std::move(mapped)) {}
+
+// Returns the entry of a position, or nullptr if the book doesn't have it
+const OpeningBook::Entry *OpeningBook::probe(const Position &position) const {
+	const std::uint64_t key = position.getCanonicalHash();
+	const Entry *found = std::lower_bound(entries, entries + count, key,
+			[](const Entry &entry, std::uint64_t value) { return entry.key < value; });
+	if (found == entries + count || found->key != key)
+		return nullptr;
+	return found;
+}
+
+// Sorts the entries and writes them as a book file, returns false on failure
+bool OpeningBook::save(const std::string &path, int boardSize, std::vector<Entry> entries) {
+	std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.key < b.key; });
+	// Keep one entry per key, a position may have been searched twice
+	entries.erase(std::unique(entries.begin(), entries.end(),
+			[](const Entry &a, const Entry &b) { return a.key == b.key; }), entries.end());
+
+	FileHeader header {};
+	std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+	header.version = FileVersion;
+	header.boardSize = boardSize;
+	header.entrySize = sizeof(Entry);
+	header.entryCount = entries.size();
+
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+	return static_cast<bool>(out);
+}
+
+// Maps a book file read-only, returns nullptr if it is missing or malformed
+std::unique_ptr<OpeningBook> OpeningBook::open(const std::string &path) {
+	MappedFile mapped;
+	if (!mapped.open(path) || mapped.size() < sizeof(FileHeader))
+		return nullptr;
+
+	FileHeader header;
+	std::memcpy(&header, mapped.data(), sizeof(header));
+	const int boardSize = static_cast<int>(header.boardSize);
+	if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 || header.version != FileVersion ||
+		boardSize < 3 || boardSize > Position::MaxSize || header.entrySize != sizeof(Entry) ||
+		(mapped.size() - sizeof(header)) / sizeof(Entry) != header.entryCount ||
+		(mapped.size() - sizeof(header)) % sizeof(Entry) != 0)
+		return nullptr;
+	return std::unique_ptr<OpeningBook>(new OpeningBook(boardSize, std::move(mapped)));
+}
+
+// File name used for the book of a board size
+std::string OpeningBook::fileName(int boardSize) {
+	return "book_" + std::to_string(boardSize) + ".bin";
+}
+
+// Returns the book for a board size, mapping it from disk on first use
+const OpeningBook *OpeningBook::forSize(int boardSize) {
+	static std::map<int, std::unique_ptr<OpeningBook>> books;
+	auto found = books.find(boardSize);
+	if (found == books.end()) {
+		std::unique_ptr<OpeningBook> book = open(fileName(boardSize));
+		if (book && book->getSize() != boardSize)
+			book.reset();
+		found = books.emplace(boardSize, std::move(book)).first;
+	}
+	return found->second.get();
+}
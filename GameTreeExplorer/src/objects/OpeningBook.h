@@ -0,0 +1,59 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Position.h"
+
+// Precomputed best moves for the positions of the first plies of one board size
+// Entries are sorted by Position::getCanonicalHash() and the file is mapped read-only,
+// so a lookup is a binary search over the mapped entries. The keys depend on the fixed
+// Zobrist seed in Position, so changing that seed means regenerating every book
+class OpeningBook
+{
+public:
+    static constexpr std::uint32_t FileVersion = 1; // Encoding version written to book files
+
+    struct Entry
+    {
+        std::uint64_t key;    // Canonical hash of the position
+        std::int32_t score;   // Search score for the side to move
+        std::uint8_t token;   // Token of the side to move to play, the same for the twin
+        std::uint8_t depth;   // Depth the position was searched to
+        std::uint16_t flags;  // Reserved
+    };
+
+private:
+    int size;
+    const Entry *entries;
+    std::uint64_t count;
+    MappedFile file;
+
+    // Constructor wrapping a mapped book file whose header was checked
+    OpeningBook(int boardSize, MappedFile mapped);
+
+public:
+    int getSize() const { return size; }
+    std::uint64_t entryCount() const { return count; }
+
+    // Returns the entry of a position, or nullptr if the book doesn't have it
+    const Entry *probe(const Position &position) const;
+
+    // Sorts the entries and writes them as a book file, returns false on failure
+    static bool save(const std::string &path, int boardSize, std::vector<Entry> entries);
+
+    // Maps a book file read-only, returns nullptr if it is missing or malformed
+    static std::unique_ptr<OpeningBook> open(const std::string &path);
+
+    // File name used for the book of a board size
+    static std::string fileName(int boardSize);
+
+    // Returns the book for a board size, mapping it from disk on first use
+    // Returns nullptr if no book file exists for that size
+    static const OpeningBook *forSize(int boardSize);
+};
+
+#endif // OPENINGBOOK_H
@@ -0,0 +1,265 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+// Compact move: which token of which player moves, and the coordinate it
+// moves from and to along its own row (player 0) or column (player 1)
+struct Move
+{
+    std::uint8_t player;
+    std::uint8_t token;
+    std::uint8_t from;
+    std::uint8_t to;
+};
+
+// Compact, SFML-free snapshot of the game used by the search engines.
+// Player 0 token i always stays on row i + 1 and only its x changes,
+// player 1 token i always stays on column i + 1 and only its y changes,
+// so a whole position is two small arrays of coordinates plus the side to move.
+// The rules are symmetric under transposing the board and swapping the players:
+// player 0 token i at x maps to player 1 token i at y = x. A position and this
+// twin have the same value for their side to move, so caches key on getCanonicalHash().
+class Position
+{
+public:
+    static constexpr int MaxSize = 32;                  // Largest supported board (including edges)
+    static constexpr int MaxTokens = MaxSize - 2;       // Tokens per player on the largest board
+    static constexpr int MaxMoves = MaxTokens;          // Every token has at most one move
+    static constexpr int MaxGameLength = 2 * MaxTokens * (MaxSize - 1); // Every move advances a token
+
+private:
+    // Random keys used to hash positions incrementally
+    struct Zobrist
+    {
+        std::uint64_t token[2][MaxTokens][MaxSize];
+        std::uint64_t side;
+        std::uint64_t size[MaxSize + 1];
+
+        Zobrist()
+        {
+            std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+            auto next = [&seed]()
+            {
+                // splitmix64
+                std::uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return z ^ (z >> 31);
+            };
+            for (auto &player : token)
+                for (auto &tokenKeys : player)
+                    for (auto &key : tokenKeys)
+                        key = next();
+            side = next();
+            for (auto &key : size)
+                key = next();
+        }
+    };
+
+    static const Zobrist &zobrist()
+    {
+        static const Zobrist table;
+        return table;
+    }
+
+    int size;                                            // Board width/height including edges
+    int tokenCount;                                      // Tokens per player (size - 2)
+    int sideToMove;                                      // Player to move (0 or 1)
+    std::array<std::array<std::uint8_t, MaxTokens>, 2> coords{}; // Coordinate of every token
+    std::array<int, 2> finished{};                       // Tokens that reached the far edge
+    std::array<int, 2> distance{};                       // Total steps left to the far edge
+    std::uint64_t hashKey;                               // Zobrist hash of the position
+    std::uint64_t twinKey;                               // Zobrist hash of the transposed twin
+
+public:
+    // Constructor building the starting position for the given board size
+    explicit Position(int boardSize = 3)
+        : size(boardSize), tokenCount(boardSize - 2), sideToMove(0),
+          hashKey(zobrist().size[boardSize])
+    {
+        for (int player = 0; player < 2; ++player)
+        {
+            distance[player] = tokenCount * (size - 1);
+            for (int token = 0; token < tokenCount; ++token)
+                hashKey ^= zobrist().token[player][token][0];
+        }
+        // The start position is its own twin with the other player to move
+        twinKey = hashKey ^ zobrist().side;
+    }
+
+    int getSize() const { return size; }
+    int getTokenCount() const { return tokenCount; }
+    int getSideToMove() const { return sideToMove; }
+    std::uint64_t getHash() const { return hashKey; }
+
+    // Returns the same hash for a position and its transposed twin
+    std::uint64_t getCanonicalHash() const { return hashKey < twinKey ? hashKey : twinKey; }
+
+    // Turns the position into its twin: the board transposed and the players swapped
+    void transpose()
+    {
+        std::swap(coords[0], coords[1]);
+        std::swap(finished[0], finished[1]);
+        std::swap(distance[0], distance[1]);
+        std::swap(hashKey, twinKey);
+        sideToMove = 1 - sideToMove;
+    }
+
+    // Returns the coordinate of a token along its row/column
+    int getCoord(int player, int token) const { return coords[player][token]; }
+
+    // Returns the total number of steps the player's tokens still need
+    int getRemainingDistance(int player) const { return distance[player]; }
+
+    // Returns how many of the player's tokens reached the far edge
+    int getFinishedCount(int player) const { return finished[player]; }
+
+    // Checks if all of the player's tokens reached the far edge
+    bool hasWon(int player) const { return finished[player] == tokenCount; }
+
+    // Checks if either player has won
+    bool isGameOver() const { return hasWon(0) || hasWon(1); }
+
+    // Checks if the armies can no longer meet, which makes the rest of the game a pure race
+    // Player 0 token i and player 1 token j can only meet at cell (j + 1, i + 1), so they
+    // are apart for good once either token has moved past that cell. Without meetings every
+    // move is a single step onto a free cell and nobody ever has to pass
+    bool isRace() const
+    {
+        // Lowest player 1 coordinate among tokens j and above, per j
+        std::array<int, MaxTokens + 1> lowestFrom;
+        lowestFrom[tokenCount] = size;
+        for (int token = tokenCount - 1; token >= 0; --token)
+            lowestFrom[token] = coords[1][token] < lowestFrom[token + 1] ? coords[1][token] : lowestFrom[token + 1];
+
+        // Player 0 token i at x has yet to cross the columns of player 1 tokens x - 1 and above
+        for (int token = 0; token < tokenCount; ++token)
+        {
+            const int firstColumn = coords[0][token] > 0 ? coords[0][token] - 1 : 0;
+            if (firstColumn < tokenCount && lowestFrom[firstColumn] <= token + 1)
+                return false;
+        }
+        return true;
+    }
+
+    // In a race the side to move wins if it needs no more steps than the opponent
+    bool winsRace() const { return distance[sideToMove] <= distance[1 - sideToMove]; }
+
+    // Plies left in a race: the winner's last step ends the game
+    int racePlies() const
+    {
+        return winsRace() ? 2 * distance[sideToMove] - 1 : 2 * distance[1 - sideToMove];
+    }
+
+    // Returns the player owning the token at (x, y), or -1 if the cell is empty
+    int ownerAt(int x, int y) const
+    {
+        if (y >= 1 && y <= tokenCount && coords[0][y - 1] == x)
+            return 0;
+        if (x >= 1 && x <= tokenCount && coords[1][x - 1] == y)
+            return 1;
+        return -1;
+    }
+
+    // Converts a token coordinate to board (x, y)
+    static std::array<int, 2> toCell(int player, int token, int coord)
+    {
+        if (player == 0)
+            return {coord, token + 1};
+        return {token + 1, coord};
+    }
+
+    // Returns the coordinate the token would move to, or -1 if it can't move
+    // A token steps forward onto an empty cell or jumps a single token in front of it
+    int getTarget(int player, int token) const
+    {
+        const int from = coords[player][token];
+        if (from >= size - 1)
+            return -1;
+
+        auto occupied = [&](int coord)
+        {
+            const auto cell = toCell(player, token, coord);
+            return ownerAt(cell[0], cell[1]) != -1;
+        };
+
+        if (!occupied(from + 1))
+            return from + 1;
+        if (from + 2 <= size - 1 && !occupied(from + 2))
+            return from + 2;
+        return -1;
+    }
+
+    // Checks if the player has at least one legal move
+    bool hasMoves(int player) const
+    {
+        for (int token = 0; token < tokenCount; ++token)
+        {
+            if (getTarget(player, token) != -1)
+                return true;
+        }
+        return false;
+    }
+
+    // Fills out with the legal moves of the side to move and returns their count
+    int generateMoves(Move *out) const
+    {
+        int count = 0;
+        for (int token = 0; token < tokenCount; ++token)
+        {
+            const int to = getTarget(sideToMove, token);
+            if (to == -1)
+                continue;
+            out[count++] = Move{static_cast<std::uint8_t>(sideToMove),
+                                static_cast<std::uint8_t>(token),
+                                coords[sideToMove][token],
+                                static_cast<std::uint8_t>(to)};
+        }
+        return count;
+    }
+
+    // Places a token at the given coordinate, keeping hash and counters in sync
+    void setCoord(int player, int token, int coord)
+    {
+        const int old = coords[player][token];
+        hashKey ^= zobrist().token[player][token][old] ^ zobrist().token[player][token][coord];
+        twinKey ^= zobrist().token[1 - player][token][old] ^ zobrist().token[1 - player][token][coord];
+        distance[player] += old - coord;
+        finished[player] += (coord == size - 1) - (old == size - 1);
+        coords[player][token] = static_cast<std::uint8_t>(coord);
+    }
+
+    // Sets the player to move
+    void setSideToMove(int player)
+    {
+        if (player != sideToMove)
+        {
+            hashKey ^= zobrist().side;
+            twinKey ^= zobrist().side;
+        }
+        sideToMove = player;
+    }
+
+    // Plays a move; the turn passes unless the opponent has no legal move
+    void makeMove(const Move &move)
+    {
+        setCoord(move.player, move.token, move.to);
+        const int opponent = 1 - move.player;
+        if (!hasMoves(opponent) && hasMoves(move.player))
+            setSideToMove(move.player);
+        else
+            setSideToMove(opponent);
+    }
+
+    // Takes back a move played with makeMove
+    void unmakeMove(const Move &move)
+    {
+        setCoord(move.player, move.token, move.from);
+        setSideToMove(move.player);
+    }
+};
+
+#endif // POSITION_H
@@ -0,0 +1,443 @@
+#include "ProofSearch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+constexpr std::uint32_t ProofInfinity = std::numeric_limits<std::uint32_t>::max() / 2; // Proof number of a disproven node
+constexpr std::uint32_t NoNode = std::numeric_limits<std::uint32_t>::max();
+
+// Adds proof numbers, saturating at infinity
+std::uint32_t addProof(std::uint32_t a, std::uint32_t b) {
+	return a + b >= ProofInfinity ? ProofInfinity : a + b;
+}
+
+// Node of the proof-number search tree
+// Positions are not stored, they are rebuilt by replaying moves from the root
+struct PnsNode {
+	std::uint32_t proof;        // Leaves still to prove for the root player to win
+	std::uint32_t disproof;     // Leaves still to prove for the root player to lose
+	std::uint32_t parent;
+	std::uint32_t firstChild;   // Children are stored next to each other
+	std::uint8_t childCount;
+	bool expanded;
+	bool orNode;                // The root player is to move here
+	Move move;                  // Move leading from the parent to this node
+};
+
+// Proof-number search over one root position
+class ProofNumberSearch {
+private:
+	std::vector<PnsNode> nodes;
+	Position position;          // Position of the node currently visited
+	int rootSide;
+	const Algorithm::SearchConfig &config;
+
+	// Sets the proof numbers of a fresh leaf from known results
+	void initLeaf(PnsNode &node) {
+		const bool rootToMove = position.getSideToMove() == rootSide;
+		node.orNode = rootToMove;
+		// Mobility initialisation: a node with many moves is easy to prove for
+		// the side to move and hard to prove for the other side
+		Move moves[Position::MaxMoves];
+		const std::uint32_t mobility = std::max(1, position.generateMoves(moves));
+		node.proof = rootToMove ? 1 : mobility;
+		node.disproof = rootToMove ? mobility : 1;
+
+		bool rootWins;
+		if (position.hasWon(rootSide)) {
+			rootWins = true;
+		} else if (position.hasWon(1 - rootSide)) {
+			rootWins = false;
+		} else if (position.isRace()) {
+			rootWins = position.winsRace() == rootToMove;
+		} else {
+			const TranspositionTable::Entry *entry = Algorithm::solverTable().probe(position.getCanonicalHash());
+			if (!entry || entry->depth != TranspositionTable::SolvedDepth)
+				return;
+			rootWins = (entry->score > 0) == rootToMove;
+		}
+		node.proof = rootWins ? 0 : ProofInfinity;
+		node.disproof = rootWins ? ProofInfinity : 0;
+	}
+
+	// Recomputes a node's proof numbers from its children
+	void updateNode(std::uint32_t index) {
+		PnsNode &node = nodes[index];
+		std::uint32_t proof = node.orNode ? ProofInfinity : 0;
+		std::uint32_t disproof = node.orNode ? 0 : ProofInfinity;
+		for (std::uint32_t i = node.firstChild; i < node.firstChild + node.childCount; ++i) {
+			const PnsNode &child = nodes[i];
+			if (node.orNode) {
+				proof = std::min(proof, child.proof);
+				disproof = addProof(disproof, child.disproof);
+			} else {
+				proof = addProof(proof, child.proof);
+				disproof = std::min(disproof, child.disproof);
+			}
+		}
+		node.proof = proof;
+		node.disproof = disproof;
+
+		// Share proven results with the other solvers and later turns
+		if (proof == 0 || disproof == 0) {
+			const bool sideWins = (proof == 0) == node.orNode;
+			Algorithm::solverTable().store(position.getCanonicalHash(), sideWins ? Algorithm::WinScore : -Algorithm::WinScore,
+					TranspositionTable::SolvedDepth, TranspositionTable::Exact);
+		}
+	}
+
+	// Walks from the root to the most-proving leaf, playing its moves on position
+	std::uint32_t selectMostProving() {
+		std::uint32_t index = 0;
+		while (nodes[index].expanded) {
+			const PnsNode &node = nodes[index];
+			std::uint32_t next = node.firstChild;
+			for (std::uint32_t i = node.firstChild; i < node.firstChild + node.childCount; ++i) {
+				if (node.orNode ? nodes[i].proof == node.proof : nodes[i].disproof == node.disproof) {
+					next = i;
+					break;
+				}
+			}
+			index = next;
+			position.makeMove(nodes[index].move);
+		}
+		return index;
+	}
+
+	// Creates the children of a leaf
+	void expand(std::uint32_t index) {
+		Move moves[Position::MaxMoves];
+		const int count = position.generateMoves(moves);
+		const std::uint32_t first = static_cast<std::uint32_t>(nodes.size());
+		for (int i = 0; i < count; ++i) {
+			PnsNode child {1, 1, index, NoNode, 0, false, false, moves[i]};
+			position.makeMove(moves[i]);
+			initLeaf(child);
+			position.unmakeMove(moves[i]);
+			nodes.push_back(child);
+		}
+		nodes[index].firstChild = first;
+		nodes[index].childCount = static_cast<std::uint8_t>(count);
+		nodes[index].expanded = true;
+	}
+
+	// Updates the proof numbers from a leaf back up to the root, taking its moves back
+	void backPropagate(std::uint32_t index) {
+		while (true) {
+			updateNode(index);
+			if (index == 0)
+				break;
+			position.unmakeMove(nodes[index].move);
+			index = nodes[index].parent;
+		}
+	}
+
+public:
+	ProofNumberSearch(const Position &root, const Algorithm::SearchConfig &config)
+		: position(root), rootSide(root.getSideToMove()), config(config) {}
+
+	// Runs the search and fills in the result
+	void run(Algorithm::SearchResult &result) {
+		const auto start = std::chrono::steady_clock::now();
+		auto elapsedMs = [&start]() {
+			return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start).count());
+		};
+
+		nodes.reserve(std::min<std::size_t>(config.pnsMaxNodes, 1 << 16));
+		// The root is expanded even when the solver table or a race already decides it,
+		// since a move still has to be picked from its children
+		nodes.push_back(PnsNode {1, 1, NoNode, NoNode, 0, false, true, Move {}});
+		expand(0);
+		backPropagate(0);
+
+		std::uint64_t iterations = 0;
+		while (nodes[0].proof != 0 && nodes[0].disproof != 0) {
+			// Stop when the tree can't take another expansion, time runs out or a stop is requested
+			if (nodes.size() + Position::MaxMoves > config.pnsMaxNodes)
+				break;
+			if ((++iterations & 255) == 0 && (config.stop.stop_requested()
+					|| (config.timeLimitMs > 0 && elapsedMs() >= config.timeLimitMs)))
+				break;
+
+			std::uint32_t leaf = selectMostProving();
+			expand(leaf);
+			backPropagate(leaf);
+		}
+
+		result.stats.nodes = nodes.size();
+		result.stats.timeMs = elapsedMs();
+		result.proven = nodes[0].proof == 0 || nodes[0].disproof == 0;
+		result.score = nodes[0].proof == 0 ? Algorithm::WinScore : (nodes[0].disproof == 0 ? -Algorithm::WinScore : 0);
+		extractLine(result);
+	}
+
+	// Follows the most-proving children from the root as the expected line
+	void extractLine(Algorithm::SearchResult &result) const {
+		result.line.length = 0;
+		std::uint32_t index = 0;
+		while (nodes[index].expanded && nodes[index].childCount > 0 &&
+			   result.line.length < Algorithm::PrincipalVariation::MaxLength) {
+			const PnsNode &node = nodes[index];
+			std::uint32_t best = node.firstChild;
+			for (std::uint32_t i = node.firstChild; i < node.firstChild + node.childCount; ++i) {
+				// The side to move prefers the child closest to its own proof
+				if (node.orNode ? nodes[i].proof < nodes[best].proof : nodes[i].disproof < nodes[best].disproof)
+					best = i;
+			}
+			result.line.moves[result.line.length++] = nodes[best].move;
+			index = best;
+		}
+	}
+};
+
+// Proof and disproof numbers of a position for the side to move
+struct DfpnEntry {
+	std::uint64_t key;
+	std::uint32_t proof;
+	std::uint32_t disproof;
+	std::uint64_t work;         // Nodes searched to get these numbers, used for replacement
+};
+
+// Fixed-size two-way hash table holding all of the df-pn search state
+// Proven entries and entries that took more work are kept over cheap ones
+class DfpnTable {
+private:
+	std::vector<DfpnEntry> entries;
+	std::size_t bucketMask = 0;
+	std::size_t megabytes = 0;
+
+	static bool isProven(const DfpnEntry &entry) {
+		return entry.proof == 0 || entry.disproof == 0;
+	}
+
+public:
+	// Reallocates the table if the memory cap changed
+	void reserve(std::size_t megabytesCap) {
+		if (megabytesCap == megabytes)
+			return;
+		std::size_t buckets = 1;
+		while (buckets * 4 * sizeof(DfpnEntry) <= megabytesCap * 1024 * 1024)
+			buckets *= 2;
+		entries.assign(buckets * 2, DfpnEntry {0, 0, 0, 0});
+		bucketMask = buckets - 1;
+		megabytes = megabytesCap;
+	}
+
+	// Reads the numbers stored for a position
+	bool lookup(std::uint64_t key, std::uint32_t &proof, std::uint32_t &disproof) const {
+		const DfpnEntry *bucket = &entries[(key & bucketMask) * 2];
+		for (int i = 0; i < 2; ++i) {
+			if (bucket[i].work != 0 && bucket[i].key == key) {
+				proof = bucket[i].proof;
+				disproof = bucket[i].disproof;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Stores the numbers of a position, evicting the less valuable entry of its bucket
+	void store(std::uint64_t key, std::uint32_t proof, std::uint32_t disproof, std::uint64_t work) {
+		DfpnEntry *bucket = &entries[(key & bucketMask) * 2];
+		DfpnEntry *victim = &bucket[0];
+		for (int i = 0; i < 2; ++i) {
+			if (bucket[i].work == 0 || bucket[i].key == key) {
+				victim = &bucket[i];
+				break;
+			}
+			if (isProven(*victim) != isProven(bucket[i]) ? isProven(*victim) : bucket[i].work < victim->work)
+				victim = &bucket[i];
+		}
+		*victim = DfpnEntry {key, proof, disproof, work};
+	}
+};
+
+// Table shared by all df-pn searches, kept across bot turns
+DfpnTable &dfpnTable() {
+	static DfpnTable table;
+	return table;
+}
+
+// Depth-first proof-number search over one root position
+// Proof numbers are stored for the side to move, so a child's numbers swap roles
+// whenever the turn passes to the other player
+class DfpnSearch {
+private:
+	DfpnTable &table;
+	Position position;
+	const Algorithm::SearchConfig &config;
+	std::chrono::steady_clock::time_point start;
+	std::uint64_t nodes = 0;
+	bool stopped = false;
+
+	// Checks the clock and the stop request every few thousand nodes
+	bool outOfTime() {
+		if (!stopped && (nodes & 4095) == 0)
+			stopped = config.stop.stop_requested() || (config.timeLimitMs > 0
+					&& std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(config.timeLimitMs));
+		return stopped;
+	}
+
+	// Reads the numbers of the position after a move, seen from the mover's side
+	void lookupChild(const Move &move, std::uint32_t &proof, std::uint32_t &disproof) {
+		const int side = position.getSideToMove();
+		position.makeMove(move);
+		const int childSide = position.getSideToMove();
+		std::uint32_t childProof = 1;
+		std::uint32_t childDisproof = 1;
+		if (position.hasWon(childSide)) {
+			childProof = 0;
+			childDisproof = ProofInfinity;
+		} else if (position.hasWon(1 - childSide)) {
+			childProof = ProofInfinity;
+			childDisproof = 0;
+		} else if (position.isRace()) {
+			childProof = position.winsRace() ? 0 : ProofInfinity;
+			childDisproof = position.winsRace() ? ProofInfinity : 0;
+		} else if (!table.lookup(position.getCanonicalHash(), childProof, childDisproof)) {
+			const TranspositionTable::Entry *entry = Algorithm::solverTable().probe(position.getCanonicalHash());
+			if (entry && entry->depth == TranspositionTable::SolvedDepth) {
+				childProof = entry->score > 0 ? 0 : ProofInfinity;
+				childDisproof = entry->score > 0 ? ProofInfinity : 0;
+			}
+		}
+		position.unmakeMove(move);
+
+		proof = childSide == side ? childProof : childDisproof;
+		disproof = childSide == side ? childDisproof : childProof;
+	}
+
+	// Multiple iterative deepening: searches the current position until its proof
+	// or disproof number reaches its threshold, returning the nodes searched
+	std::uint64_t mid(std::uint32_t thProof, std::uint32_t thDisproof) {
+		++nodes;
+		std::uint64_t work = 1;
+		const int side = position.getSideToMove();
+		Move moves[Position::MaxMoves];
+		const int count = position.generateMoves(moves);
+
+		while (true) {
+			std::uint32_t proof = ProofInfinity;
+			std::uint32_t disproof = 0;
+			int best = 0;
+			std::uint32_t bestProof = ProofInfinity;
+			std::uint32_t bestDisproof = 0;
+			std::uint32_t secondProof = ProofInfinity;
+			for (int i = 0; i < count; ++i) {
+				std::uint32_t childProof, childDisproof;
+				lookupChild(moves[i], childProof, childDisproof);
+				proof = std::min(proof, childProof);
+				disproof = addProof(disproof, childDisproof);
+				if (childProof < bestProof) {
+					secondProof = bestProof;
+					best = i;
+					bestProof = childProof;
+					bestDisproof = childDisproof;
+				} else if (childProof < secondProof) {
+					secondProof = childProof;
+				}
+			}
+
+			if (proof >= thProof || disproof >= thDisproof || outOfTime()) {
+				table.store(position.getCanonicalHash(), proof, disproof, work);
+				if (proof == 0 || disproof == 0)
+					Algorithm::solverTable().store(position.getCanonicalHash(), proof == 0 ? Algorithm::WinScore : -Algorithm::WinScore,
+							TranspositionTable::SolvedDepth, TranspositionTable::Exact);
+				return work;
+			}
+
+			// Stay in the best child until it is no longer clearly the best (1 + 1/4 trick)
+			const std::uint32_t childThProof = std::min<std::uint64_t>(thProof, secondProof + secondProof / 4 + 1);
+			const std::uint32_t childThDisproof = thDisproof >= ProofInfinity
+					? ProofInfinity : addProof(thDisproof - disproof, bestDisproof);
+
+			position.makeMove(moves[best]);
+			if (position.getSideToMove() == side)
+				work += mid(childThProof, childThDisproof);
+			else
+				work += mid(childThDisproof, childThProof);
+			position.unmakeMove(moves[best]);
+		}
+	}
+
+public:
+	DfpnSearch(DfpnTable &table, const Position &root, const Algorithm::SearchConfig &config)
+		: table(table), position(root), config(config), start(std::chrono::steady_clock::now()) {}
+
+	// Runs the search and fills in the result
+	void run(Algorithm::SearchResult &result) {
+		mid(ProofInfinity - 1, ProofInfinity - 1);
+
+		std::uint32_t proof = 1;
+		std::uint32_t disproof = 1;
+		table.lookup(position.getCanonicalHash(), proof, disproof);
+		result.stats.nodes = nodes;
+		result.stats.timeMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count());
+		result.proven = proof == 0 || disproof == 0;
+		result.score = proof == 0 ? Algorithm::WinScore : (disproof == 0 ? -Algorithm::WinScore : 0);
+		extractLine(result);
+	}
+
+	// Follows the child with the smallest proof number for the mover as the expected line
+	void extractLine(Algorithm::SearchResult &result) {
+		result.line.length = 0;
+		Position root = position;
+		while (!position.isGameOver() && result.line.length < Algorithm::PrincipalVariation::MaxLength) {
+			Move moves[Position::MaxMoves];
+			const int count = position.generateMoves(moves);
+			if (count == 0)
+				break;
+			int best = 0;
+			std::uint32_t bestProof = ProofInfinity + 1;
+			for (int i = 0; i < count; ++i) {
+				std::uint32_t childProof, childDisproof;
+				lookupChild(moves[i], childProof, childDisproof);
+				if (childProof < bestProof) {
+					best = i;
+					bestProof = childProof;
+				}
+			}
+			result.line.moves[result.line.length++] = moves[best];
+			position.makeMove(moves[best]);
+		}
+		position = root;
+	}
+};
+} // namespace
+
+// Best-first proof-number search proving whether the side to move can force a win
+Algorithm::SearchResult Algorithm::proofNumberSearch(const Position &position, const SearchConfig &config) {
+	SearchResult result;
+	Move moves[Position::MaxMoves];
+	if (position.isGameOver() || position.generateMoves(moves) == 0)
+		return result;
+
+	ProofNumberSearch search(position, config);
+	search.run(result);
+	result.hasMove = result.line.length > 0;
+	if (result.hasMove)
+		result.bestMove = result.line.moves[0];
+	return result;
+}
+
+// Depth-first proof-number (df-pn) search proving whether the side to move can force a win
+Algorithm::SearchResult Algorithm::depthFirstProofNumberSearch(const Position &position, const SearchConfig &config) {
+	SearchResult result;
+	Move moves[Position::MaxMoves];
+	if (position.isGameOver() || position.generateMoves(moves) == 0)
+		return result;
+
+	DfpnTable &table = dfpnTable();
+	table.reserve(config.dfpnMemoryMb);
+	DfpnSearch search(table, position, config);
+	search.run(result);
+	result.hasMove = result.line.length > 0;
+	if (result.hasMove)
+		result.bestMove = result.line.moves[0];
+	return result;
+}
@@ -0,0 +1,21 @@
+#ifndef PROOFSEARCH_H
+#define PROOFSEARCH_H
+
+#include "Algo.h"
+#include "Position.h"
+
+namespace Algorithm {
+// Best-first proof-number search proving whether the side to move can force a win
+// Keeps expanding the most-proving leaf until the root is proven or disproven,
+// the tree reaches config.pnsMaxNodes nodes, or config.timeLimitMs runs out
+// Unsolved searches report the move closest to a proof with a score of 0
+SearchResult proofNumberSearch(const Position &position, const SearchConfig &config);
+
+// Depth-first proof-number (df-pn) search proving whether the side to move can force a win
+// Uses a fixed-size hash table of config.dfpnMemoryMb megabytes as its only storage;
+// the table is kept between calls so proven positions stay available for later turns
+SearchResult depthFirstProofNumberSearch(const Position &position, const SearchConfig &config);
+
+} // namespace Algorithm
+
+#endif // PROOFSEARCH_H
@@ -0,0 +1,87 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size hash table of search results keyed by Position::getCanonicalHash()
+// Each slot holds one entry; a new result replaces the old one unless the old
+// one belongs to the same position and was searched deeper
+class TranspositionTable
+{
+public:
+    // Kind of score stored in an entry
+    enum Bound : std::uint8_t
+    {
+        None,
+        Lower, // Real score is at least the stored score
+        Upper, // Real score is at most the stored score
+        Exact
+    };
+
+    static constexpr std::uint16_t SolvedDepth = 0xFFFF; // Depth of results proven to the end of the game
+
+    struct Entry
+    {
+        std::uint64_t key;
+        std::int32_t score;
+        std::uint16_t depth;
+        std::uint8_t bound;
+        std::uint8_t move;    // Token index of the best move, 0xFF if unknown
+    };
+
+private:
+    std::vector<Entry> entries;
+    std::size_t mask;
+
+public:
+    // Constructor allocating roughly the given number of megabytes
+    explicit TranspositionTable(std::size_t megabytes = 16)
+    {
+        resize(megabytes);
+    }
+
+    // Reallocates the table, dropping all stored results
+    void resize(std::size_t megabytes)
+    {
+        std::size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024)
+            count *= 2;
+        entries.assign(count, Entry{0, 0, 0, None, 0xFF});
+        mask = count - 1;
+    }
+
+    // Drops all stored results
+    void clear()
+    {
+        entries.assign(entries.size(), Entry{0, 0, 0, None, 0xFF});
+    }
+
+    // Returns the entry stored for the key, or nullptr if there is none
+    const Entry *probe(std::uint64_t key) const
+    {
+        const Entry &entry = entries[key & mask];
+        if (entry.bound == None || entry.key != key)
+            return nullptr;
+        return &entry;
+    }
+
+    // Stores a result, keeping a deeper result for the same position
+    void store(std::uint64_t key, int score, int depth, Bound bound, int move = 0xFF)
+    {
+        Entry &entry = entries[key & mask];
+        if (entry.bound != None && entry.key == key && entry.depth > depth)
+            return;
+        entry = Entry{key, static_cast<std::int32_t>(score), static_cast<std::uint16_t>(depth),
+                      bound, static_cast<std::uint8_t>(move)};
+    }
+
+    // Number of slots in the table
+    std::size_t size() const
+    {
+        return entries.size();
+    }
+};
+
+#endif // TRANSPOSITIONTABLE_H
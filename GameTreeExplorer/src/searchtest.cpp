@@ -0,0 +1,74 @@
+#include "objects/Algo.h"
+#include "objects/GameTable.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+// Checks that the search proves the position with the table's result and distance
+// Returns false and reports the position if it doesn't
+bool checkDistance(const GameTable &table, const Position &position, const char *name)
+{
+    Algorithm::SearchConfig config;
+    config.timeLimitMs = 0;
+    config.useGameTables = false;
+    config.useOpeningBook = false;
+    Algorithm::searchTable().clear();
+    const Algorithm::SearchResult result = Algorithm::iterativeDeepening(position, config);
+
+    const bool wins = table.probe(position) == GameTable::Win;
+    const int plies = table.pliesToEnd(position);
+    const int score = wins ? Algorithm::WinScore - plies : -(Algorithm::WinScore - plies);
+    if (result.proven && result.score == score)
+        return true;
+    std::cerr << name << ": expected score " << score << ", search returned " << result.score
+              << (result.proven ? " (proven)" : " (not proven)") << " at depth " << result.stats.depth << "\n";
+    return false;
+}
+} // namespace
+
+// Checks the alpha-beta search against the retrograde game table of a 5x5 board
+// Every position it proves must come with the table's exact distance, races included
+int main()
+{
+    const GameTable table = GameTable::solve(5);
+    int failures = 0;
+
+    // A race mate beyond the first decisive iteration hid a win two plies quicker
+    Position race(5);
+    const int coords[2][3] = {{1, 2, 1}, {2, 1, 2}};
+    for (int player = 0; player < 2; ++player)
+        for (int token = 0; token < 3; ++token)
+            race.setCoord(player, token, coords[player][token]);
+    race.setSideToMove(0);
+    failures += !checkDistance(table, race, "race position");
+
+    // Positions of random openings
+    std::mt19937 random(5);
+    for (int sample = 0; sample < 100; ++sample)
+    {
+        Position position(5);
+        const int plies = static_cast<int>(random() % 16);
+        Move moves[Position::MaxMoves];
+        for (int ply = 0; ply < plies && !position.isGameOver(); ++ply)
+        {
+            const int count = position.generateMoves(moves);
+            if (count == 0)
+                break;
+            position.makeMove(moves[random() % count]);
+        }
+        if (position.isGameOver() || position.generateMoves(moves) == 0)
+            continue;
+        failures += !checkDistance(table, position, ("random position " + std::to_string(sample)).c_str());
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " positions failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "All proven distances match the game table\n";
+    return EXIT_SUCCESS;
+}
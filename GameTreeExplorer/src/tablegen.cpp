@@ -0,0 +1,60 @@
+#include "objects/GameTable.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Offline tool solving every position of a board size and writing its game table
+// Usage: tablegen [--wdl] <board size including edges> [output file] [threads]
+// Tables store the distance to the end of every game unless --wdl asks for values only
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args;
+    GameTable::Encoding encoding = GameTable::Distance;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--wdl")
+            encoding = GameTable::WinLoss;
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (args.empty())
+    {
+        std::cerr << "Usage: tablegen [--wdl] <board size including edges> [output file] [threads]\n";
+        return 1;
+    }
+
+    try
+    {
+        const int size = std::stoi(args[0]);
+        const std::string path = args.size() > 1 ? args[1] : GameTable::fileName(size);
+        const int threads = args.size() > 2 ? std::stoi(args[2]) : 0;
+
+        std::cout << "Solving " << size << "x" << size << " board..." << std::endl;
+        GameTable table = GameTable::solve(size, threads);
+        std::cout << "Starting position is a "
+                  << (table.probe(Position(size)) == GameTable::Win ? "win" : "loss")
+                  << " for the first player in " << table.pliesToEnd(Position(size)) << " plies" << std::endl;
+
+        if (!table.save(path, encoding))
+        {
+            std::cerr << "Failed to write " << path << "\n";
+            return 1;
+        }
+        // Map the written file back and check it the way the game will read it
+        const std::unique_ptr<GameTable> written = GameTable::open(path);
+        if (!written || !written->verify())
+        {
+            std::cerr << "Verification of " << path << " failed\n";
+            return 1;
+        }
+        std::cout << "Wrote " << table.entryCount() << " positions to " << path << std::endl;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}